@@ -3,6 +3,7 @@
 #include <BulletCollision/CollisionShapes/btBoxShape.h>
 #include <BulletCollision/CollisionShapes/btCapsuleShape.h>
 #include <BulletCollision/CollisionShapes/btSphereShape.h>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include "../managers/engine.h"
 #include "../managers/mesh_manager.h"
@@ -11,6 +12,7 @@
 #include "../window/window.h"
 #include "../window/input.h"
 
+#include "../entities/material.h"
 #include "../entities/node.h"
 #include "../entities/scene.h"
 #include "../entities/shader_program.h"
@@ -26,7 +28,13 @@
 #include "../entities/components/portal/teleportable.h"
 #include "../managers/physics_manager.h"
 
+#include "../render-pipeline/culling/occlusion_culler.h"
+#include "../render-pipeline/culling/occlusion_queries.h"
+#include "../render-pipeline/culling/render_queue.h"
+#include "../render-pipeline/geometry/multi_draw_renderer.h"
 #include "../render-pipeline/portal/portal.h"
+#include "../render-pipeline/portal/portal_system.h"
+#include "../render-pipeline/state/gl_state_cache.h"
 
 using namespace SimpleGL;
 
@@ -58,6 +66,9 @@ class BasicDemo {
     std::shared_ptr<Texture> cubeDiffuseTexture;
     std::shared_ptr<Texture> cubeSpecularTexture;
 
+    /// Shared by the ground and the walls
+    std::shared_ptr<Material> greyMaterial;
+
     // This node contains static elements of the scene
     std::shared_ptr<Node> staticNode;
 
@@ -65,13 +76,26 @@ class BasicDemo {
     std::vector<std::shared_ptr<Teleportable>> teleportables;
     std::shared_ptr<MeshComponent> skyboxCubeMesh;
 
+    /// Small cubes at the night lights, drawn with one instanced call. Null without night lights
+    std::shared_ptr<MeshComponent> nightLightMarkers;
+    std::vector<glm::mat4> nightLightMarkerTransforms;
+
+    RenderQueue renderQueue;
+    std::shared_ptr<OcclusionCuller> occlusionCuller = std::make_shared<OcclusionCuller>();
+    std::shared_ptr<OcclusionQueries> occlusionQueries;
+
+    /// Draws static geometry with one indirect call per pass, null without OpenGL 4.3
+    std::unique_ptr<MultiDrawRenderer> multiDrawRenderer;
+
 public:
+    std::shared_ptr<PortalSystem> portalSystem;
     std::shared_ptr<Portal> portal;
 
     std::shared_ptr<Camera> camera;
     std::shared_ptr<Scene> scene;
 
-    BasicDemo() {
+    /// @param nightLights adds a grid of 256 point lights shaded through clustered lighting
+    explicit BasicDemo(const bool nightLights = false) {
         scene = std::make_shared<Scene>();
         Engine::get()->setScene(scene);
 
@@ -80,7 +104,7 @@ public:
 
         dynamicsWorld()->setGravity(btVector3(0, -10.f, 0));
 
-        createScene();
+        createScene(nightLights);
     }
 
     void stepPhysicsSimulation() {
@@ -89,103 +113,196 @@ public:
     }
 
     void draw() {
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
+        const auto& glState = Engine::get()->glState();
+
+        glState->apply(PipelineState::opaque());
 
         // Clear color & depth buffers
-        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
         glClearColor(0.f, 1.f, 1.f, 1.f);
-
-        glDepthMask(GL_TRUE);
         glClearDepth(1);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        occlusionQueries->update();
+
         // define draw call
-        const auto drawCall = [this](const std::shared_ptr<Camera>& _camera) {
-            for (const auto& mesh : meshes) {
+        const auto drawCall = [this, &glState](const std::shared_ptr<Camera>& _camera) {
+            // query results are valid for the main camera only
+            const bool isMainCamera = _camera == camera;
+
+            for (const auto& mesh : renderQueue.cull(_camera)) {
+                if (multiDrawRenderer != nullptr && multiDrawRenderer->submit(mesh)) {
+                    continue;
+                }
+
+                if (isMainCamera) {
+                    occlusionQueries->beginConditionalRender(mesh.get());
+                }
+
                 mesh->draw(_camera);
+
+                if (isMainCamera) {
+                    occlusionQueries->endConditionalRender(mesh.get());
+                }
+            }
+
+            if (multiDrawRenderer != nullptr) {
+                multiDrawRenderer->flush(_camera);
             }
 
             for (const auto& teleportable : teleportables) {
                 teleportable->draw(_camera);
             }
 
-            glCullFace(GL_FRONT);
-            glDepthFunc(GL_LEQUAL);
+            if (nightLightMarkers != nullptr) {
+                nightLightMarkers->drawInstanced(_camera, nightLightMarkerTransforms);
+            }
+
+            glState->setCullFace(GL_FRONT);
+            glState->setDepthFunc(GL_LEQUAL);
             skyboxCubeMesh->draw(_camera);
-            glDepthFunc(GL_LESS);
-            glCullFace(GL_BACK);
+            glState->setDepthFunc(GL_LESS);
+            glState->setCullFace(GL_BACK);
         };
 
         // draw portals contents
-        portal->drawPortal(2, drawCall);
-        portal->drawPortal(1, drawCall);
+        portalSystem->drawPortals(drawCall);
 
         // portal->applyCameraNearPlane();
 
         // draw the rest of scene
-        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-        glEnable(GL_DEPTH_TEST);
-        glDepthMask(GL_TRUE);
-        glDepthFunc(GL_LESS);
-        glDisable(GL_STENCIL_TEST);
-        glStencilMask(0x00);
+        glState->apply(PipelineState::opaque());
 
         drawCall(camera);
+
+        // test visibility against the complete depth buffer for the next frames
+        portalSystem->queryPortals();
+        occlusionQueries->queryOccludees(camera);
     }
 
 private:
-    void createScene() {
+    void createScene(const bool nightLights) {
         createShaders();
 
+        occlusionQueries = std::make_shared<OcclusionQueries>();
+
+        if (MultiDrawRenderer::isSupported()) {
+            multiDrawRenderer = std::make_unique<MultiDrawRenderer>();
+            multiDrawRenderer->gpuCulling = true;
+        }
+
         createCamera();
 
         createSkybox();
         createPortal();
 
         staticNode = Node::create("staticNode", rootNode);
+        staticNode->isStatic = true;
         createGround();
         createWalls();
 
         createLightSource();
+        if (nightLights) {
+            createNightLights();
+        }
         createCube();
 
         // Uncomment one of these:
         // createFreeCameraController();
         createFPSController();
+
+        for (const auto& mesh : meshes) {
+            renderQueue.add(mesh);
+        }
+
+        renderQueue.setOcclusionCuller(occlusionCuller);
     }
 
     void createShaders() {
-        basicShader = Engine::get()->shaderManager()->createShaderProgram(
+        const auto& shaderManager = Engine::get()->shaderManager();
+
+        // all programs are submitted first, the driver compiles them while assets are loaded
+        const auto basicShaderHandle = shaderManager->createShaderProgramAsync(
             "shaders/basic/vertex.glsl",
             "shaders/basic/fragment.glsl",
             "basic shader program"
         );
 
-        solidColorShader = Engine::get()->shaderManager()->createShaderProgram(
+        const auto solidColorShaderHandle = shaderManager->createShaderProgramAsync(
             "shaders/solid-color/vertex.glsl",
             "shaders/solid-color/fragment.glsl",
             "solid color shader program"
         );
 
-        blinnPhongShader = Engine::get()->shaderManager()->createShaderProgram(
-            "shaders/blinn-phong/vertex.glsl",
-            "shaders/blinn-phong/fragment.glsl",
-            "Blinn-Phong Shader"
+        const auto blinnPhongShaderHandle = shaderManager->createShaderProgramAsync(
+            "shaders/lit/vertex.glsl",
+            "shaders/lit/fragment.glsl",
+            "Blinn-Phong Shader",
+            LightingFeature | TexturedFeature | ClusteredFeature
         );
 
-        shadedSolidColorShader = Engine::get()->shaderManager()->createShaderProgram(
-            "shaders/shaded-solid-color/vertex.glsl",
-            "shaders/shaded-solid-color/fragment.glsl",
-            "Blinn-Phong Solid Color Shader"
+        const auto shadedSolidColorShaderHandle = shaderManager->createShaderProgramAsync(
+            "shaders/lit/vertex.glsl",
+            "shaders/lit/fragment.glsl",
+            "Blinn-Phong Solid Color Shader",
+            LightingFeature | ClusteredFeature
         );
 
-        skyboxShader = Engine::get()->shaderManager()->createShaderProgram(
+        const auto skyboxShaderHandle = shaderManager->createShaderProgramAsync(
             "shaders/skybox/vertex.glsl",
             "shaders/skybox/fragment.glsl",
             "Skybox Shader"
         );
+
+        loadAssets();
+
+        basicShader = basicShaderHandle->wait();
+        solidColorShader = solidColorShaderHandle->wait();
+        blinnPhongShader = blinnPhongShaderHandle->wait();
+        shadedSolidColorShader = shadedSolidColorShaderHandle->wait();
+        skyboxShader = skyboxShaderHandle->wait();
+
+        greyMaterial = createColorMaterial(shadedSolidColorShader, glm::vec3(0.3, 0.3, 0.3));
+    }
+
+    /// Meshes are kept by the mesh manager, textures by the demo
+    void loadAssets() {
+        // positions are read alone by portal stencil and depth passes
+        meshManager()->vertexLayout = VertexLayout::Split;
+
+        // high-poly meshes take half the vertex memory and bandwidth quantized
+        meshManager()->vertexPrecision = VertexPrecision::Quantized;
+
+        for (const auto* path : { "./capsule.obj", "./sphere.obj" }) {
+            meshManager()->loadMeshData(path);
+        }
+
+        meshManager()->vertexPrecision = VertexPrecision::Float;
+
+        for (const auto* path : { "./cube.obj", "cube.obj", "plane.obj" }) {
+            meshManager()->loadMeshData(path);
+        }
+
+        skyboxTexture = Engine::get()->textureManager()->getCubeMapTexture(
+            "sky",
+            "skybox/right.jpg",
+            "skybox/left.jpg",
+            "skybox/top.jpg",
+            "skybox/bottom.jpg",
+            "skybox/front.jpg",
+            "skybox/back.jpg",
+            false
+        );
+
+        cubeDiffuseTexture = Engine::get()->textureManager()->getTexture("diffuse.png", true);
+        cubeSpecularTexture = Engine::get()->textureManager()->getTexture("specular.png", false);
+    }
+
+    static std::shared_ptr<Material> createColorMaterial(const std::shared_ptr<ShaderProgram>& shader, const glm::vec3& color) {
+        auto material = std::make_shared<Material>(shader, "colorMaterial");
+        material->setParameter("color", color);
+
+        return material;
     }
 
     void createCamera() {
@@ -209,10 +326,7 @@ private:
 
         auto capsule = meshManager()->loadMeshData("./capsule.obj");
         auto playerMesh = MeshComponent::Factory::create(meshNode, capsule, "Player Mesh");
-        playerMesh->setShader(shadedSolidColorShader);
-        playerMesh->setBeforeDrawCallback([](const std::shared_ptr<ShaderProgram>& shaderProgram) {
-            shaderProgram->setUniform("color", glm::vec3(0.6, 0.6, 0.6));
-        });
+        playerMesh->setMaterial(createColorMaterial(shadedSolidColorShader, glm::vec3(0.6, 0.6, 0.6)));
 
         meshes.push_back(playerMesh);
 
@@ -238,10 +352,7 @@ private:
 
         auto cube = meshManager()->loadMeshData("./cube.obj");
         auto weaponMesh = MeshComponent::Factory::create(weaponNode, cube, "Weapon Mesh");
-        weaponMesh->setShader(shadedSolidColorShader);
-        weaponMesh->setBeforeDrawCallback([](const std::shared_ptr<ShaderProgram>& shaderProgram) {
-            shaderProgram->setUniform("color", glm::vec3(0.8, 0.5, 0.5));
-        });
+        weaponMesh->setMaterial(createColorMaterial(shadedSolidColorShader, glm::vec3(0.8, 0.5, 0.5)));
 
         meshes.push_back(weaponMesh);
 
@@ -273,14 +384,10 @@ private:
         };
 
         auto bullet1Node = createBullet("bullet1Node", portal->portal1Node);
-        bullet1Node->getComponent<MeshComponent>()->setBeforeDrawCallback([](const std::shared_ptr<ShaderProgram>& shaderProgram) {
-            shaderProgram->setUniform("color", glm::vec3(0.1, 0.1, 0.8));
-        });
+        bullet1Node->getComponent<MeshComponent>()->setMaterial(createColorMaterial(solidColorShader, glm::vec3(0.1, 0.1, 0.8)));
 
         auto bullet2Node = createBullet("bullet2Node", portal->portal2Node);
-        bullet2Node->getComponent<MeshComponent>()->setBeforeDrawCallback([](const std::shared_ptr<ShaderProgram>& shaderProgram) {
-            shaderProgram->setUniform("color", glm::vec3(0.8, 0.1, 0.1));
-        });
+        bullet2Node->getComponent<MeshComponent>()->setMaterial(createColorMaterial(solidColorShader, glm::vec3(0.8, 0.1, 0.1)));
 
         // Controller
         auto controller = PortalFPSController::Factory::create(playerNode, "playerController");
@@ -305,31 +412,22 @@ private:
     }
 
     void createSkybox() {
-        skyboxTexture = Engine::get()->textureManager()->getCubeMapTexture(
-            "sky",
-            "skybox/right.jpg",
-            "skybox/left.jpg",
-            "skybox/top.jpg",
-            "skybox/bottom.jpg",
-            "skybox/front.jpg",
-            "skybox/back.jpg",
-            false
-        );
-
         auto node = meshManager()->createNodeFromMeshData("cube.obj", rootNode);
         node->name = "skyboxCube";
 
         skyboxCubeMesh = node->getComponent<MeshComponent>();
-        skyboxCubeMesh->setShader(skyboxShader);
-        skyboxCubeMesh->setBeforeDrawCallback([this](const auto& shaderProgram) {
-            shaderProgram->setTexture("cubeMap", skyboxTexture);
-        });
+        const auto material = std::make_shared<Material>(skyboxShader, "skyboxMaterial");
+        material->setTexture("cubeMap", skyboxTexture);
+
+        skyboxCubeMesh->setMaterial(material);
     }
 
     void createPortal() {
         auto node = Node::create("portal", rootNode);
 
-        portal = Portal::create(camera);
+        portalSystem = std::make_shared<PortalSystem>(camera);
+        portalSystem->setOcclusionQueries(occlusionQueries);
+        portal = portalSystem->createPortal();
 
         // position portals
         portal->portal1Node->transform()->setPosition(-8, -3, -14.45);
@@ -354,19 +452,13 @@ private:
         portal1BorderNode->transform()->scaleBy(1.05);
 
         auto portal1BorderMesh = portal1BorderNode->getComponent<MeshComponent>();
-        portal1BorderMesh->setShader(solidColorShader);
-        portal1BorderMesh->setBeforeDrawCallback([](const auto& shader) {
-            shader->setUniform("color", 0.05f, 0.15f, 1.f);
-        });
+        portal1BorderMesh->setMaterial(createColorMaterial(solidColorShader, glm::vec3(0.05f, 0.15f, 1.f)));
 
         auto portal2BorderNode = portal->portal2Node->getChild("childNode")->getChild("borderNode");
         portal2BorderNode->transform()->scaleBy(1.05);
 
         auto portal2BorderMesh = portal2BorderNode->getComponent<MeshComponent>();
-        portal2BorderMesh->setShader(solidColorShader);
-        portal2BorderMesh->setBeforeDrawCallback([](const auto& shader) {
-            shader->setUniform("color", 1.f, 0.05f, 0.05f);
-        });
+        portal2BorderMesh->setMaterial(createColorMaterial(solidColorShader, glm::vec3(1.f, 0.05f, 0.05f)));
     }
 
     void createGround() {
@@ -376,12 +468,14 @@ private:
         node->transform()->setPosition(0, -5, 0);
 
         auto mesh = node->getComponent<MeshComponent>();
-        mesh->setShader(shadedSolidColorShader);
-        mesh->setBeforeDrawCallback([](const std::shared_ptr<ShaderProgram>& shaderProgram) {
-            shaderProgram->setUniform("color", glm::vec3(0.3, 0.3, 0.3));
-        });
+        mesh->setMaterial(greyMaterial);
 
         meshes.push_back(mesh);
+        occlusionCuller->addOccluder(mesh);
+
+        if (multiDrawRenderer != nullptr) {
+            multiDrawRenderer->add(mesh, glm::vec3(0.3, 0.3, 0.3));
+        }
 
         auto groundShape = std::make_shared<btBoxShape>(btVector3(50.f, 0.5, 50.f));
         auto rigidbody = RigidBody::Factory::create(node);
@@ -415,12 +509,14 @@ private:
             }
 
             auto mesh = node->getComponent<MeshComponent>();
-            mesh->setShader(shadedSolidColorShader);
-            mesh->setBeforeDrawCallback([](const std::shared_ptr<ShaderProgram>& shaderProgram) {
-                shaderProgram->setUniform("color", glm::vec3(0.3, 0.3, 0.3));
-            });
+            mesh->setMaterial(greyMaterial);
 
             meshes.push_back(mesh);
+            occlusionCuller->addOccluder(mesh);
+
+            if (multiDrawRenderer != nullptr) {
+                multiDrawRenderer->add(mesh, glm::vec3(0.3, 0.3, 0.3));
+            }
 
             auto rigidbody = RigidBody::Factory::create(node);
             rigidbody->setCollisionShape(wallShape);
@@ -437,10 +533,7 @@ private:
         node->transform()->setOrientation(glm::quat(glm::radians(glm::vec3(45, -45, 0))));
 
         auto mesh = node->getComponent<MeshComponent>();
-        mesh->setShader(solidColorShader);
-        mesh->setBeforeDrawCallback([](const std::shared_ptr<ShaderProgram>& shaderProgram) {
-            shaderProgram->setUniform("color", 1, 1, 1);
-        });
+        mesh->setMaterial(createColorMaterial(solidColorShader, glm::vec3(1, 1, 1)));
 
         meshes.push_back(mesh);
         const auto pointLight = PointLight::Factory::create(node);
@@ -455,6 +548,48 @@ private:
         directLight->specular = glm::vec3(0.04);
     }
 
+    /// Grid of small colored point lights, used to stress clustered lighting
+    void createNightLights() {
+        constexpr int gridSize = 16;
+        constexpr float spacing = 2.f;
+
+        for (int i = 0; i < gridSize * gridSize; i++) {
+            const int x = i % gridSize;
+            const int z = i / gridSize;
+
+            const auto node = Node::create("nightLight" + std::to_string(i), staticNode);
+            node->transform()->setPosition(
+                (static_cast<float>(x) - gridSize / 2.f) * spacing,
+                -4.f,
+                (static_cast<float>(z) - gridSize / 2.f) * spacing
+            );
+
+            const auto pointLight = PointLight::Factory::create(node);
+            pointLight->ambient = glm::vec3(0.0);
+            pointLight->diffuse = glm::vec3(x % 3 == 0, x % 3 == 1, x % 3 == 2) * 0.6f + glm::vec3(0.1f);
+            pointLight->specular = glm::vec3(0.1);
+            pointLight->distance = 2.5f;
+
+            nightLightMarkerTransforms.push_back(
+                glm::scale(glm::translate(glm::mat4(1), node->transform()->position()), glm::vec3(0.05f))
+            );
+        }
+
+        const auto instancedShader = Engine::get()->shaderManager()->createShaderProgram(
+            "shaders/lit/vertex.glsl",
+            "shaders/lit/fragment.glsl",
+            "Instanced Solid Color Shader",
+            LightingFeature | ClusteredFeature | InstancedFeature
+        );
+
+        // the node's own transform is unused, every instance has its matrix
+        const auto node = meshManager()->createNodeFromMeshData("cube.obj", rootNode);
+        node->name = "nightLightMarkers";
+
+        nightLightMarkers = node->getComponent<MeshComponent>();
+        nightLightMarkers->setMaterial(createColorMaterial(instancedShader, glm::vec3(1, 1, 0.8)));
+    }
+
     void createCube() {
         const auto node = meshManager()->createNodeFromMeshData("cube.obj", rootNode);
         node->name = "cube";
@@ -462,15 +597,13 @@ private:
 
         auto mesh = node->getComponent<MeshComponent>();
 
-        cubeDiffuseTexture = Engine::get()->textureManager()->getTexture("diffuse.png", true);
-        cubeSpecularTexture = Engine::get()->textureManager()->getTexture("specular.png", false);
+        const auto material = std::make_shared<Material>(blinnPhongShader, "cubeMaterial");
+        material->setTexture("diffuseTexture", cubeDiffuseTexture);
+        material->setTexture("specularTexture", cubeSpecularTexture);
 
-        mesh->setShader(blinnPhongShader);
-        mesh->setBeforeDrawCallback([this](const std::shared_ptr<ShaderProgram>& shaderProgram) {
-            shaderProgram->setTexture("diffuseTexture", cubeDiffuseTexture);
-            shaderProgram->setTexture("specularTexture", cubeSpecularTexture);
-        });
+        mesh->setMaterial(material);
         meshes.push_back(mesh);
+        occlusionQueries->addOccludee(mesh);
 
         auto cubeShape = std::make_shared<btBoxShape>(btVector3(0.5f, 0.5f, 0.5f));
         auto rigidBody = RigidBody::Factory::create(node);
@@ -1,14 +1,17 @@
 #include "camera.h"
 
 #include "transform.h"
+#include "../../render-pipeline/portal/render_view.h"
 #include "../../managers/engine.h"
 #include "../../window/window.h"
 
 namespace SimpleGL {
 
 void Camera::recalculateViewMatrix() {
+    m_position = transform()->absolutePosition();
+
     m_viewMatrix = glm::mat4_cast(glm::conjugate(transform()->absoluteOrientation()));
-    m_viewMatrix = glm::translate(m_viewMatrix, -transform()->absolutePosition());
+    m_viewMatrix = glm::translate(m_viewMatrix, -m_position);
 }
 
 void Camera::recalculateProjectionMatrix() {
@@ -17,58 +20,96 @@ void Camera::recalculateProjectionMatrix() {
     m_projectionMatrix = glm::perspective(m_fov, aspect, m_near, m_far);
 }
 
-// Lengyel, Eric. "Oblique View Frustum Depth Projection and Clipping".
-// Journal of Game Development, Vol. 1, No. 2 (2005)
-// http://www.terathon.com/code/oblique.html
 void Camera::setNearPlane(const std::shared_ptr<Transform> &planeTransform) {
     recalculateProjectionMatrix();
 
-    glm::mat4 projection = projectionMatrix();
+    m_projectionMatrix = obliqueProjection(
+        m_projectionMatrix,
+        m_viewMatrix,
+        m_position,
+        planeTransform->direction(),
+        planeTransform->position()
+    );
+}
+
+void Camera::setRenderView(const RenderView& renderView) {
+    m_position = renderView.position;
+    m_viewMatrix = renderView.viewMatrix;
+    m_projectionMatrix = renderView.projectionMatrix;
+}
+
+// Lengyel, Eric. "Oblique View Frustum Depth Projection and Clipping".
+// Journal of Game Development, Vol. 1, No. 2 (2005)
+// http://www.terathon.com/code/oblique.html
+glm::mat4 Camera::obliqueProjection(
+    const glm::mat4& projection,
+    const glm::mat4& viewMatrix,
+    const glm::vec3& position,
+    const glm::vec3& planeNormal,
+    const glm::vec3& planePosition
+) {
+    glm::mat4 result = projection;
 
-    auto normalViewMatrix = calculateViewNormalMatrix();
+    auto normalViewMatrix = calculateViewNormalMatrix(viewMatrix, position);
 
-    auto portalNormal = planeTransform->direction();
-    auto portalPosition = planeTransform->position();
-    float D = -glm::dot(portalNormal, portalPosition);
+    float D = -glm::dot(planeNormal, planePosition);
 
-    auto clipPlane = glm::vec4(portalNormal, D);
+    auto clipPlane = glm::vec4(planeNormal, D);
     clipPlane = normalViewMatrix * clipPlane;
 
     if (clipPlane.w > 0.0f)
         clipPlane = -clipPlane;
 
     auto q = glm::vec4(
-        (glm::sign(clipPlane.x) + projection[2][0]) / projection[0][0],
-        (glm::sign(clipPlane.y) + projection[2][1]) / projection[1][1],
+        (glm::sign(clipPlane.x) + result[2][0]) / result[0][0],
+        (glm::sign(clipPlane.y) + result[2][1]) / result[1][1],
         -1.0f,
-        (1.0f + projection[2][2]) / projection[3][2]
+        (1.0f + result[2][2]) / result[3][2]
     );
 
     glm::vec4 c = clipPlane * (2.0f / (glm::dot(clipPlane, q)));
 
-    projection[0][2] = c.x;
-    projection[1][2] = c.y;
-    projection[2][2] = c.z + 1.f;
-    projection[3][2] = c.w;
+    result[0][2] = c.x;
+    result[1][2] = c.y;
+    result[2][2] = c.z + 1.f;
+    result[3][2] = c.w;
+
+    return result;
+}
+
+glm::mat4 Camera::cullingMatrix() const {
+    const float scaleX = 2.f / (m_screenRect.z - m_screenRect.x);
+    const float scaleY = 2.f / (m_screenRect.w - m_screenRect.y);
 
-    m_projectionMatrix = projection;
+    // maps screenRect to the whole NDC square
+    glm::mat4 crop = glm::mat4(1);
+    crop[0][0] = scaleX;
+    crop[1][1] = scaleY;
+    crop[3][0] = -(m_screenRect.x + m_screenRect.z) * 0.5f * scaleX;
+    crop[3][1] = -(m_screenRect.y + m_screenRect.w) * 0.5f * scaleY;
+
+    return crop * m_projectionMatrix * m_viewMatrix;
+}
+
+glm::mat4 Camera::calculateViewNormalMatrix() const {
+    return calculateViewNormalMatrix(m_viewMatrix, m_position);
 }
 
 /// normalView = inverse(transpose(viewMatrix))
 /// After substitution and simplification we will get:
 /// viewNormal = conjugate(rotation) * transpose(translation)
-glm::mat4 Camera::calculateViewNormalMatrix() const {
+glm::mat4 Camera::calculateViewNormalMatrix(const glm::mat4& viewMatrix, const glm::vec3& position) {
     // optimized version of:
-    // return glm::inverse(glm::transpose(viewMatrix()));
+    // return glm::inverse(glm::transpose(viewMatrix));
 
-    auto normalViewMatrix = viewMatrix();
+    auto normalViewMatrix = viewMatrix;
 
     normalViewMatrix[3][0] = 0;
     normalViewMatrix[3][1] = 0;
     normalViewMatrix[3][2] = 0;
-    normalViewMatrix[0][3] = transform()->position().x;
-    normalViewMatrix[1][3] = transform()->position().y;
-    normalViewMatrix[2][3] = transform()->position().z;
+    normalViewMatrix[0][3] = position.x;
+    normalViewMatrix[1][3] = position.y;
+    normalViewMatrix[2][3] = position.z;
 
     return normalViewMatrix;
 }
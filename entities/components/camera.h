@@ -8,6 +8,8 @@
 
 namespace SimpleGL {
 
+struct RenderView;
+
 class Camera : public Component {
 public:
     class Factory : public ComponentFactory<Camera> {};
@@ -25,13 +27,39 @@ public:
     const glm::mat4& viewMatrix() const { return m_viewMatrix; }
     const glm::mat4& projectionMatrix() const { return m_projectionMatrix; }
 
+    /// Position in world space, updated together with the view matrix
+    const glm::vec3& position() const { return m_position; }
+
     void recalculateViewMatrix();
     void recalculateProjectionMatrix();
 
     void setNearPlane(const std::shared_ptr<Transform>& planeTransform);
 
+    /// Sets the view of a camera which is not attached to a node, such as a portal virtual camera
+    void setRenderView(const RenderView& renderView);
+
+    /// Lengyel, Eric. "Oblique View Frustum Depth Projection and Clipping".
+    /// Replaces near plane of projection with the plane given in world space
+    static glm::mat4 obliqueProjection(
+        const glm::mat4& projection,
+        const glm::mat4& viewMatrix,
+        const glm::vec3& position,
+        const glm::vec3& planeNormal,
+        const glm::vec3& planePosition
+    );
+
+    /// Part of the screen visible through the camera, in NDC: (minX, minY, maxX, maxY).
+    /// Narrows the frustum used for culling, the projection matrix is not affected
+    const glm::vec4& screenRect() const { return m_screenRect; }
+    void setScreenRect(const glm::vec4& screenRect) { m_screenRect = screenRect; }
+
+    /// View-projection matrix whose frustum is cropped to screenRect
+    glm::mat4 cullingMatrix() const;
+
     glm::mat4 calculateViewNormalMatrix() const;
 
+    static glm::mat4 calculateViewNormalMatrix(const glm::mat4& viewMatrix, const glm::vec3& position);
+
 private:
     float m_fov = 0;
     float m_near = 0;
@@ -39,6 +67,9 @@ private:
 
     glm::mat4 m_viewMatrix = glm::mat4(1);
     glm::mat4 m_projectionMatrix = glm::mat4(1);
+    glm::vec3 m_position = glm::vec3(0);
+
+    glm::vec4 m_screenRect = glm::vec4(-1, -1, 1, 1);
 };
 
 }
@@ -4,9 +4,12 @@
 
 #include "camera.h"
 #include "transform.h"
+#include "../material.h"
 #include "../mesh_data.h"
 #include "../node.h"
 #include "../shader_program.h"
+#include "../../render-pipeline/deferred/deferred_renderer.h"
+#include "../../render-pipeline/geometry/vertex_format.h"
 
 namespace SimpleGL {
 
@@ -15,31 +18,93 @@ MeshComponent::MeshComponent(
     const std::string &name
 ):
     Component(name),
-    m_meshData(meshData)
-{
-    m_VAO = createVAO();
-}
+    m_meshData(meshData),
+    m_vertexFormat(&meshData->vertexFormat())
+{}
 
-MeshComponent::~MeshComponent() {
-    glDeleteVertexArrays(1, &m_VAO);
+unsigned int MeshComponent::VAO() const {
+    return m_meshData->VAO(*m_vertexFormat);
 }
 
 void MeshComponent::setShader(const std::shared_ptr<ShaderProgram> &shaderProgram) {
+    // instanced VAOs read the mesh attributes plus the instance transform
+    const auto& instancedFormat = VertexFormat::instanced(*m_vertexFormat);
+
+    for (const auto& [attribName, attrib] : shaderProgram->attribs()) {
+        // built-in inputs like gl_VertexID may be reported as attributes
+        if (attribName.starts_with("gl_") || instancedFormat.hasLocation(attrib->location)) {
+            continue;
+        }
+
+        throw std::runtime_error(std::format(
+            "MESH COMPONENT. Shader attribute has no location in the vertex format. Name: {}, shader: {}, attribute: {}, format: {}",
+            name, shaderProgram->label, attribName, m_vertexFormat->name
+        ));
+    }
+
     m_shaderProgram = shaderProgram;
+}
 
-    glBindVertexArray(m_VAO);
-    enableVertexAttrib("vPosition", true, 3);
-    enableVertexAttrib("vTextureCoord", false, 2);
-    enableVertexAttrib("vNormal", false, 3);
-    glBindVertexArray(0);
-    m_attribOffset = 0;
+void MeshComponent::setMaterial(const std::shared_ptr<Material>& material) {
+    m_material = material;
+
+    if (m_shaderProgram != material->shader()) {
+        setShader(material->shader());
+    }
+}
+
+uint64_t MeshComponent::sortKey() const {
+    const uint64_t shaderId = m_shaderProgram != nullptr ? m_shaderProgram->id : 0;
+    const uint64_t materialId = m_material != nullptr ? m_material->id() : 0;
+
+    return shaderId << 32 | materialId;
 }
 
 void MeshComponent::draw(const std::shared_ptr<Camera>& camera) const {
+    draw(camera, transform()->transformMatrix());
+}
+
+void MeshComponent::draw(const std::shared_ptr<Camera>& camera, const glm::mat4& transformMatrix) const {
     if (node()->visible == false) {
         return;
     }
 
+    const auto& shaderProgram = useShader(camera);
+
+    // instanced variants read the world matrix from the instance stream only
+    if (shaderProgram->attribExists("vTransform")) {
+        drawInstances(shaderProgram, &transformMatrix, 1);
+        return;
+    }
+
+    if (shaderProgram->uniformExists("transform")) {
+        shaderProgram->setUniform("transform", transformMatrix);
+    }
+
+    applyMaterial(shaderProgram);
+
+    glBindVertexArray(VAO());
+    glDrawElements(GL_TRIANGLES, m_meshData->indices().size(), GL_UNSIGNED_INT, 0);
+}
+
+void MeshComponent::drawInstanced(const std::shared_ptr<Camera>& camera, const std::vector<glm::mat4>& transformMatrices) const {
+    if (node()->visible == false || transformMatrices.empty()) {
+        return;
+    }
+
+    const auto& shaderProgram = useShader(camera);
+
+    if (!shaderProgram->attribExists("vTransform")) {
+        throw std::runtime_error(std::format(
+            "MESH COMPONENT. Shader has no instance transform attribute. Name: {}, shader: {}",
+            name, shaderProgram->label
+        ));
+    }
+
+    drawInstances(shaderProgram, transformMatrices.data(), transformMatrices.size());
+}
+
+const std::shared_ptr<ShaderProgram>& MeshComponent::useShader(const std::shared_ptr<Camera>& camera) const {
     if (m_shaderProgram == nullptr) {
         throw std::runtime_error(std::format(
             "MESH COMPONENT. Shader is not set. Name: {}",
@@ -47,48 +112,98 @@ void MeshComponent::draw(const std::shared_ptr<Camera>& camera) const {
         ));
     }
 
-    m_shaderProgram->use(camera);
+    // g-buffer variant shares attribute locations with the main program, so the same VAO is used
+    const auto& shaderProgram = DeferredRenderer::active() != nullptr && m_shaderProgram->gBufferVariant() != nullptr
+        ? m_shaderProgram->gBufferVariant()
+        : m_shaderProgram;
+
+    shaderProgram->use(camera);
+
+    return shaderProgram;
+}
 
-    if (m_shaderProgram->uniformExists("transform")) {
-        m_shaderProgram->setUniform("transform", transform()->transformMatrix());
+void MeshComponent::applyMaterial(const std::shared_ptr<ShaderProgram>& shaderProgram) const {
+    applyVertexDecoding(shaderProgram);
+
+    if (m_material != nullptr) {
+        m_material->apply(shaderProgram);
     }
 
-    m_beforeDrawCallback(m_shaderProgram);
+    if (m_beforeDrawCallback) {
+        m_beforeDrawCallback(shaderProgram);
 
-    glBindVertexArray(m_VAO);
-    glDrawElements(GL_TRIANGLES, m_meshData->indices().size(), GL_UNSIGNED_INT, 0);
+        // uniforms set by the callback may overwrite material parameters
+        shaderProgram->setAppliedMaterial(0);
+    }
 }
 
-unsigned int MeshComponent::createVAO() const {
-    unsigned int VAO;
-    glGenVertexArrays(1, &VAO);
+void MeshComponent::drawInstances(
+    const std::shared_ptr<ShaderProgram>& shaderProgram,
+    const glm::mat4* transformMatrices,
+    size_t count
+) const {
+    applyMaterial(shaderProgram);
+
+    // the instance buffer is created with the first instanced VAO
+    const unsigned int VAO = m_meshData->VAO(VertexFormat::instanced(*m_vertexFormat));
+
+    // buffer is respecified on every draw, so the driver doesn't wait for draws still reading the previous matrices
+    glBindBuffer(GL_ARRAY_BUFFER, m_meshData->instanceVBO());
+    glBufferData(GL_ARRAY_BUFFER, static_cast<long>(count * sizeof(glm::mat4)), transformMatrices, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
     glBindVertexArray(VAO);
+    glDrawElementsInstanced(GL_TRIANGLES, m_meshData->indices().size(), GL_UNSIGNED_INT, 0, static_cast<int>(count));
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_meshData->VBO());
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_meshData->EBO());
+void MeshComponent::drawPositions(const std::shared_ptr<Camera>& camera, const std::shared_ptr<ShaderProgram>& shaderProgram) const {
+    if (node()->visible == false) {
+        return;
+    }
+
+    shaderProgram->use(camera);
+    shaderProgram->setUniform("transform", transform()->transformMatrix());
 
-    glBindVertexArray(0);
+    applyVertexDecoding(shaderProgram);
 
-    return VAO;
+    glBindVertexArray(m_meshData->VAO(m_meshData->positionFormat()));
+    glDrawElements(GL_TRIANGLES, m_meshData->indices().size(), GL_UNSIGNED_INT, 0);
 }
 
-void MeshComponent::enableVertexAttrib(const std::string &name, bool required, int size) {
-    constexpr int positionSize = 3;
-    constexpr int textureCoordSize = 2;
-    constexpr int normalSize = 3;
-    constexpr int stride = (positionSize + textureCoordSize + normalSize) * sizeof(float);
+const AABB& MeshComponent::worldAABB() const {
+    updateWorldBounds();
+    return m_worldAABB;
+}
 
-    if (required == false && m_shaderProgram->attribExists(name) == false) {
-        m_attribOffset += size * sizeof(float);
-        return;
+const BoundingSphere& MeshComponent::worldBoundingSphere() const {
+    updateWorldBounds();
+    return m_worldBoundingSphere;
+}
+
+void MeshComponent::applyVertexDecoding(const std::shared_ptr<ShaderProgram>& shaderProgram) const {
+    // programs are shared by meshes of different formats, so decoding is set for every draw
+    if (shaderProgram->uniformExists("positionOffset")) {
+        shaderProgram->setUniform("positionOffset", m_meshData->positionOffset());
+        shaderProgram->setUniform("positionScale", m_meshData->positionScale());
+    }
+
+    if (shaderProgram->uniformExists("octahedralNormals")) {
+        shaderProgram->setUniform("octahedralNormals", m_vertexFormat->octahedralNormals ? 1 : 0);
     }
+}
 
-    const int attribLocation = m_shaderProgram->getAttribLocation(name);
+void MeshComponent::updateWorldBounds() const {
+    const auto& transform = this->transform();
+
+    if (m_worldBoundsVersion == transform->version()) {
+        return;
+    }
 
-    glVertexAttribPointer(attribLocation, size, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(m_attribOffset));
-    glEnableVertexAttribArray(attribLocation);
+    const glm::mat4 transformMatrix = transform->transformMatrix();
 
-    m_attribOffset += size * sizeof(float);
+    m_worldAABB = m_meshData->aabb().transformed(transformMatrix);
+    m_worldBoundingSphere = m_meshData->boundingSphere().transformed(transformMatrix);
+    m_worldBoundsVersion = transform->version();
 }
 
 }
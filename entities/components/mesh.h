@@ -1,14 +1,19 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <functional>
+#include <vector>
 #include "component.h"
+#include "../../render-pipeline/culling/bounds.h"
 
 namespace SimpleGL {
 
 class Camera;
+class Material;
 class ShaderProgram;
 struct MeshData;
+struct VertexFormat;
 
 class MeshComponent : public Component {
 public:
@@ -19,30 +24,69 @@ public:
         const std::string &name = "Mesh"
     );
 
-    ~MeshComponent() override;
+    /// VAO is shared with all meshes drawing the same data in the same vertex format
+    unsigned int VAO() const;
+    const std::shared_ptr<MeshData>& meshData() const { return m_meshData; }
 
-    unsigned int VAO() const { return m_VAO; }
+    const VertexFormat& vertexFormat() const { return *m_vertexFormat; }
 
+    /// Attributes of the shader must be declared with locations of the mesh's vertex format,
+    /// or with VertexFormat::INSTANCE_TRANSFORM_LOCATION for instanced variants
     void setShader(const std::shared_ptr<ShaderProgram> &shaderProgram);
 
+    /// Sets material's shader as well. Materials may be shared between meshes
+    void setMaterial(const std::shared_ptr<Material>& material);
+    const std::shared_ptr<Material>& material() const { return m_material; }
+
+    /// Escape hatch for per-draw state a material can't describe. Runs after the material is applied
     void setBeforeDrawCallback(const std::function<void(const std::shared_ptr<ShaderProgram>& shaderProgram)>& beforeDrawCallback) {
         m_beforeDrawCallback = beforeDrawCallback;
     }
 
     void draw(const std::shared_ptr<Camera>& camera = nullptr) const;
 
-private:
-    unsigned int m_VAO = 0;
-    unsigned int m_attribOffset = 0;
+    /// Draws the mesh with transformMatrix instead of its node's world matrix, without touching the scene graph
+    void draw(const std::shared_ptr<Camera>& camera, const glm::mat4& transformMatrix) const;
+
+    /// Draws one instance per world matrix with a single call. The shader must be built with InstancedFeature
+    void drawInstanced(const std::shared_ptr<Camera>& camera, const std::vector<glm::mat4>& transformMatrices) const;
+
+    /// Draws only vertex positions with shaderProgram instead of the mesh's shader and material, for depth and stencil passes.
+    /// shaderProgram must read no other attribute. With the split layout just the tightly packed positions are fetched
+    void drawPositions(const std::shared_ptr<Camera>& camera, const std::shared_ptr<ShaderProgram>& shaderProgram) const;
+
+    /// Orders draws by shader, then by material, so state changes between consecutive draws are minimal
+    uint64_t sortKey() const;
+
+    /// World space bounds, recalculated when the transform changes
+    const AABB& worldAABB() const;
+    const BoundingSphere& worldBoundingSphere() const;
 
+private:
     std::shared_ptr<MeshData> m_meshData;
+    const VertexFormat* m_vertexFormat;
     std::shared_ptr<ShaderProgram> m_shaderProgram;
+    std::shared_ptr<Material> m_material;
 
     std::function<void(const std::shared_ptr<ShaderProgram>& shaderProgram)> m_beforeDrawCallback;
 
-    unsigned int createVAO() const;
+    mutable AABB m_worldAABB;
+    mutable BoundingSphere m_worldBoundingSphere;
+    mutable uint64_t m_worldBoundsVersion = -1;
+
+    /// Makes the mesh's shader, or its g-buffer variant while a deferred renderer is active, current
+    const std::shared_ptr<ShaderProgram>& useShader(const std::shared_ptr<Camera>& camera) const;
+
+    /// Sets vertex decoding, material and callback uniforms
+    void applyMaterial(const std::shared_ptr<ShaderProgram>& shaderProgram) const;
+
+    /// Uploads world matrices into the instance buffer and draws them with the instanced VAO
+    void drawInstances(const std::shared_ptr<ShaderProgram>& shaderProgram, const glm::mat4* transformMatrices, size_t count) const;
+
+    /// Sets uniforms of include/vertex-decoding.glsl for the mesh's vertex format
+    void applyVertexDecoding(const std::shared_ptr<ShaderProgram>& shaderProgram) const;
 
-    void enableVertexAttrib(const std::string& name, bool required, int size);
+    void updateWorldBounds() const;
 };
 
 
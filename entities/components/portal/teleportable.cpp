@@ -1,10 +1,20 @@
 #include "teleportable.h"
 
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
 #include "../mesh.h"
+#include "../camera.h"
 #include "../transform.h"
 #include "../rigid_body.h"
 #include "../../node.h"
 #include "../../../helpers/converter.h"
+#include "../../../managers/engine.h"
+#include "../../../window/input.h"
+#include "../../../window/window.h"
+#include "../../mesh_data.h"
+#include "../../../render-pipeline/culling/frustum.h"
 #include "../../../render-pipeline/portal/portal.h"
 
 namespace SimpleGL {
@@ -37,11 +47,11 @@ void Teleportable::onUpdate() {
 
 void Teleportable::draw(const std::shared_ptr<Camera> &camera) const {
     if (m_isCloseEnough1) {
-        drawClone(camera, m_portal->portal1Node, m_portal->portal2Node);
+        drawClone(camera, 1);
     }
 
     if (m_isCloseEnough2) {
-        drawClone(camera, m_portal->portal2Node, m_portal->portal1Node);
+        drawClone(camera, 2);
     }
 }
 
@@ -103,33 +113,55 @@ void Teleportable::teleportIfNeed(
     }
 }
 
-void Teleportable::drawClone(
-    const std::shared_ptr<Camera>& camera,
-    const std::shared_ptr<Node>& sourcePortalNode,
-    const std::shared_ptr<Node>& destPortalNode
-) const {
-    glm::quat qNew, qDelta;
-    glm::vec3 pNew;
+void Teleportable::drawClone(const std::shared_ptr<Camera>& camera, int sourcePortalIndex) const {
+    const auto& cache = cloneCache(sourcePortalIndex);
+    const Frustum frustum(camera->cullingMatrix());
 
-    getTeleportedTransform(sourcePortalNode, destPortalNode, qNew, pNew, qDelta);
+    m_visibleClones.clear();
 
-    const auto rigidBody = node()->rigidBody();
-    const auto& originalPosition = transform()->position();
-    const auto& originalOrientation = transform()->orientation();
+    for (unsigned int i = 0; i < m_meshes.size(); i++) {
+        if (frustum.intersects(cache.worldAABBs[i])) {
+            m_visibleClones.push_back(i);
+        }
+    }
+
+    // consecutive draws share shaders and materials, as in RenderQueue
+    std::ranges::sort(m_visibleClones, {}, [this](unsigned int i) { return m_meshes[i]->sortKey(); });
 
-    node()->setRigidBody(nullptr);
-    transform()->setPosition(pNew);
-    transform()->setOrientation(qNew);
-    transform()->recalculate();
+    for (const unsigned int i : m_visibleClones) {
+        m_meshes[i]->draw(camera, cache.transformMatrices[i]);
+    }
+}
+
+const Teleportable::CloneCache& Teleportable::cloneCache(int sourcePortalIndex) const {
+    auto& cache = m_cloneCaches[sourcePortalIndex - 1];
+    const uint64_t frameIndex = Engine::get()->window()->input()->frameIndex();
+
+    if (cache.frameIndex == frameIndex && cache.transformMatrices.size() == m_meshes.size()) {
+        return cache;
+    }
+
+    const auto [qDelta, pDelta] = Portal::calculatePortalTransform(
+        m_portal->portalNode(sourcePortalIndex)->transform(),
+        m_portal->portalNode(3 - sourcePortalIndex)->transform()
+    );
+
+    // same as teleporting the node: every world matrix of its subtree is moved by the portal delta
+    const glm::mat4 deltaMatrix = glm::translate(glm::mat4(1), pDelta) * glm::mat4_cast(qDelta);
+
+    cache.transformMatrices.clear();
+    cache.worldAABBs.clear();
 
     for (const auto& mesh : m_meshes) {
-        mesh->draw(camera);
+        const glm::mat4 transformMatrix = deltaMatrix * mesh->transform()->transformMatrix();
+
+        cache.transformMatrices.push_back(transformMatrix);
+        cache.worldAABBs.push_back(mesh->meshData()->aabb().transformed(transformMatrix));
     }
 
-    transform()->setPosition(originalPosition);
-    transform()->setOrientation(originalOrientation);
-    transform()->recalculate();
-    node()->setRigidBody(rigidBody);
+    cache.frameIndex = frameIndex;
+
+    return cache;
 }
 
 void Teleportable::getTeleportedTransform(
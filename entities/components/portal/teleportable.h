@@ -1,9 +1,13 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <vector>
-#include <glm/fwd.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include "../component.h"
+#include "../../../render-pipeline/culling/bounds.h"
 
 namespace SimpleGL {
 
@@ -25,9 +29,19 @@ public:
     void onStart() override;
     void onUpdate() override;
 
+    /// Draws clones of meshes behind portals the node is close to.
+    /// Clone matrices and bounds are calculated once per frame and shared by all cameras, the scene graph is not modified.
+    /// Every camera draws only the clones inside its culling frustum, sorted by MeshComponent::sortKey
     void draw(const std::shared_ptr<Camera>& camera) const;
 
 private:
+    /// World matrices and bounds of mesh clones behind the destination portal
+    struct CloneCache {
+        uint64_t frameIndex = -1;
+        std::vector<glm::mat4> transformMatrices;
+        std::vector<AABB> worldAABBs;
+    };
+
     std::shared_ptr<Portal> m_portal;
     std::vector<std::shared_ptr<MeshComponent>> m_meshes;
 
@@ -38,6 +52,11 @@ private:
     bool m_isCloseEnough1 = false;
     bool m_isCloseEnough2 = false;
 
+    mutable std::array<CloneCache, 2> m_cloneCaches;
+
+    /// Indices of clones visible to the camera being drawn
+    mutable std::vector<unsigned int> m_visibleClones;
+
     void toggleCollisionIfNeed();
 
     void teleportIfNeed(
@@ -45,11 +64,9 @@ private:
         const std::shared_ptr<Node> &destPortalNode
     ) const;
 
-    void drawClone(
-        const std::shared_ptr<Camera>& camera,
-        const std::shared_ptr<Node>& sourcePortalNode,
-        const std::shared_ptr<Node> &destPortalNode
-    ) const;
+    void drawClone(const std::shared_ptr<Camera>& camera, int sourcePortalIndex) const;
+
+    const CloneCache& cloneCache(int sourcePortalIndex) const;
 
     void getTeleportedTransform(
         const std::shared_ptr<Node>& sourcePortalNode,
@@ -84,6 +84,7 @@ void Transform::recalculate() {
 
         m_transformMatrix = calculateTransformMatrix();
         m_direction = m_absoluteOrientation * glm::vec3(0, 0, 1);
+        m_version += 1;
     }
 
     if (rigidBody && m_dirty) {
@@ -115,6 +116,7 @@ void Transform::recalculateDetached() {
 
     m_transformMatrix = calculateTransformMatrix();
     m_direction = m_absoluteOrientation * glm::vec3(0, 0, 1);
+    m_version += 1;
 
     m_dirty = false;
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include "component.h"
 
 #include <glm/glm.hpp>
@@ -40,6 +42,9 @@ public:
     glm::vec3 direction() const { return m_direction; }
     glm::mat4 transformMatrix() const { return m_transformMatrix; }
 
+    /// Incremented every time transformMatrix changes. Used to invalidate values derived from it
+    uint64_t version() const { return m_version; }
+
     void translate(const glm::vec3& vector);
     void rotate(const glm::quat& rotation, const std::shared_ptr<Transform>& transform = nullptr);
     void scaleBy(float x);
@@ -60,6 +65,7 @@ private:
 
     glm::mat4 m_transformMatrix = glm::mat4(1.0f);
     glm::vec3 m_direction = glm::vec3(0, 0, 1);
+    uint64_t m_version = 0;
 
     bool m_dirty = false;
     bool m_subtreeDirty = false;
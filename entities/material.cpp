@@ -0,0 +1,63 @@
+#include "material.h"
+
+#include <algorithm>
+
+#include "shader_program.h"
+
+namespace SimpleGL {
+
+unsigned int Material::nextId = 1;
+
+Material::Material(const std::shared_ptr<ShaderProgram>& shader, std::string label):
+    label(std::move(label)),
+    m_shader(shader),
+    m_id(nextId++)
+{}
+
+void Material::setParameter(const std::string& name, const Value& value) {
+    const auto it = std::ranges::find(m_parameters, name, &Parameter::name);
+
+    if (it != m_parameters.end()) {
+        it->value = value;
+    } else {
+        m_parameters.push_back({ name, value });
+    }
+
+    m_version++;
+}
+
+void Material::setTexture(const std::string& name, const std::shared_ptr<Texture>& texture) {
+    const auto it = std::ranges::find(m_textures, name, &TextureBinding::name);
+
+    if (it != m_textures.end()) {
+        it->texture = texture;
+    } else {
+        m_textures.push_back({ name, texture });
+    }
+
+    m_version++;
+}
+
+void Material::apply(const std::shared_ptr<ShaderProgram>& shaderProgram) const {
+    for (const auto& [name, texture] : m_textures) {
+        if (shaderProgram->uniformExists(name)) {
+            shaderProgram->setTexture(name, texture);
+        }
+    }
+
+    if (shaderProgram->isMaterialApplied(m_id, m_version)) {
+        return;
+    }
+
+    for (const auto& [name, value] : m_parameters) {
+        if (!shaderProgram->uniformExists(name)) {
+            continue;
+        }
+
+        std::visit([&](const auto& parameter) { shaderProgram->setUniform(name, parameter); }, value);
+    }
+
+    shaderProgram->setAppliedMaterial(m_id, m_version);
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace SimpleGL {
+
+class ShaderProgram;
+struct Texture;
+
+/// Shader with typed uniform parameters and texture bindings, shared between meshes.
+/// Parameters are uploaded to a program only when another material was applied to it since, or when they change.
+/// Textures are bound on every apply, as texture units are shared by all programs.
+/// Parameters missing in a program, e.g. in its g-buffer variant, are skipped.
+class Material {
+public:
+    using Value = std::variant<int, float, glm::vec3, glm::vec4, glm::mat4>;
+
+    const std::string label;
+
+    explicit Material(const std::shared_ptr<ShaderProgram>& shader, std::string label = "Material");
+
+    const std::shared_ptr<ShaderProgram>& shader() const { return m_shader; }
+
+    /// Unique per material, used in draw sort keys
+    unsigned int id() const { return m_id; }
+
+    /// Incremented on every parameter or texture change
+    uint64_t version() const { return m_version; }
+
+    void setParameter(const std::string& name, const Value& value);
+    void setTexture(const std::string& name, const std::shared_ptr<Texture>& texture);
+
+    /// shaderProgram must be in use, it is either the material's shader or its variant
+    void apply(const std::shared_ptr<ShaderProgram>& shaderProgram) const;
+
+private:
+    static unsigned int nextId;
+
+    struct Parameter {
+        std::string name;
+        Value value;
+    };
+
+    struct TextureBinding {
+        std::string name;
+        std::shared_ptr<Texture> texture;
+    };
+
+    std::shared_ptr<ShaderProgram> m_shader;
+
+    unsigned int m_id;
+    uint64_t m_version = 0;
+
+    std::vector<Parameter> m_parameters;
+    std::vector<TextureBinding> m_textures;
+};
+
+}
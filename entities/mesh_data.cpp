@@ -1,22 +1,81 @@
 #include "mesh_data.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
 #include <queue>
 #include <glad/glad.h>
 
+#include <glm/gtc/packing.hpp>
+
 namespace SimpleGL {
 
 MeshData::~MeshData() {
+    for (const auto& [formatId, VAO] : m_VAOs) {
+        glDeleteVertexArrays(1, &VAO);
+    }
+
     glDeleteBuffers(1, &m_VBO);
+    glDeleteBuffers(1, &m_positionVBO);
     glDeleteBuffers(1, &m_EBO);
+    glDeleteBuffers(1, &m_instanceVBO);
+}
+
+const VertexFormat& MeshData::vertexFormat() const {
+    return VertexFormat::mesh(m_layout, m_precision);
+}
+
+const VertexFormat& MeshData::positionFormat() const {
+    return VertexFormat::mesh(m_layout, m_precision, true);
+}
+
+std::vector<unsigned int> MeshData::streamBuffers() const {
+    if (m_layout == VertexLayout::Split) {
+        return { m_positionVBO, m_VBO };
+    }
+
+    return { m_VBO };
 }
 
-std::shared_ptr<MeshData> MeshData::createFromScene(const aiScene *scene) {
-    auto meshData = parseScene(scene);
+unsigned int MeshData::VAO(const VertexFormat& format) {
+    const auto [it, isNew] = m_VAOs.try_emplace(format.id);
+
+    if (!isNew) {
+        return it->second;
+    }
+
+    glGenVertexArrays(1, &it->second);
+    glBindVertexArray(it->second);
+
+    auto buffers = streamBuffers();
+
+    // instanced formats read one more stream of instance data
+    if (format.strides.size() > buffers.size()) {
+        if (m_instanceVBO == 0) {
+            glGenBuffers(1, &m_instanceVBO);
+        }
+
+        buffers.push_back(m_instanceVBO);
+    }
+
+    format.apply(buffers);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return it->second;
+}
+
+std::shared_ptr<MeshData> MeshData::createFromScene(const aiScene *scene, VertexLayout layout, VertexPrecision precision) {
+    auto meshData = parseScene(scene, layout, precision);
 
     return meshData;
 }
 
-std::shared_ptr<MeshData> MeshData::parseScene(const aiScene *scene) {
+std::shared_ptr<MeshData> MeshData::parseScene(const aiScene *scene, VertexLayout layout, VertexPrecision precision) {
     auto rootNode = scene->mRootNode;
 
     while (rootNode->mNumMeshes == 0 && rootNode->mNumChildren == 1) {
@@ -36,7 +95,7 @@ std::shared_ptr<MeshData> MeshData::parseScene(const aiScene *scene) {
 
         if (currentAiNode->mNumMeshes == 1) {
             const aiMesh* mesh = scene->mMeshes[currentAiNode->mMeshes[0]];
-            fillMeshData(mesh, currentMeshData);
+            fillMeshData(mesh, currentMeshData, layout, precision);
         }
         else {
             for (int i=0; i < currentAiNode->mNumMeshes; i++) {
@@ -45,7 +104,7 @@ std::shared_ptr<MeshData> MeshData::parseScene(const aiScene *scene) {
                 auto subMeshData = std::make_shared<MeshData>();
                 currentMeshData->m_subMeshes.push_back(subMeshData);
 
-                fillMeshData(mesh, subMeshData);
+                fillMeshData(mesh, subMeshData, layout, precision);
             }
         }
 
@@ -61,11 +120,14 @@ std::shared_ptr<MeshData> MeshData::parseScene(const aiScene *scene) {
     return meshData;
 }
 
-void MeshData::fillMeshData(const aiMesh *mesh, const std::shared_ptr<MeshData> &meshData) {
+void MeshData::fillMeshData(const aiMesh *mesh, const std::shared_ptr<MeshData> &meshData, VertexLayout layout, VertexPrecision precision) {
     if (mesh->mNumFaces == 0 || mesh->mNumVertices == 0) {
         return;
     }
 
+    meshData->m_layout = layout;
+    meshData->m_precision = precision;
+
     const bool hasTextureCoords = mesh->HasTextureCoords(0);
     const bool hasNormals = mesh->HasNormals();
 
@@ -109,6 +171,13 @@ void MeshData::fillMeshData(const aiMesh *mesh, const std::shared_ptr<MeshData>
         }
     }
 
+    calculateBounds(mesh, meshData);
+
+    if (precision == VertexPrecision::Quantized) {
+        meshData->m_positionOffset = meshData->m_aabb.min;
+        meshData->m_positionScale = meshData->m_aabb.max - meshData->m_aabb.min;
+    }
+
     createBuffers(meshData);
 }
 
@@ -133,12 +202,51 @@ unsigned int MeshData::calculateVertexSize(const aiMesh *mesh) {
     return result;
 }
 
+void MeshData::calculateBounds(const aiMesh *mesh, const std::shared_ptr<MeshData> &meshData) {
+    glm::vec3 min = glm::vec3(mesh->mVertices[0].x, mesh->mVertices[0].y, mesh->mVertices[0].z);
+    glm::vec3 max = min;
+
+    for (unsigned int i=1; i < mesh->mNumVertices; i++) {
+        const auto vertex = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+
+        min = glm::min(min, vertex);
+        max = glm::max(max, vertex);
+    }
+
+    meshData->m_aabb = { min, max };
+
+    // sphere around the box center is not minimal, but tighter than the box's circumscribed sphere
+    const glm::vec3 center = meshData->m_aabb.center();
+    float radius2 = 0;
+
+    for (unsigned int i=0; i < mesh->mNumVertices; i++) {
+        const auto vertex = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+        const glm::vec3 offset = vertex - center;
+
+        radius2 = std::max(radius2, glm::dot(offset, offset));
+    }
+
+    meshData->m_boundingSphere = { center, std::sqrt(radius2) };
+}
+
 void MeshData::createBuffers(const std::shared_ptr<MeshData> &meshData) {
     glBindVertexArray(0);
 
+    const auto streams = meshData->encodeVertices();
+
     glGenBuffers(1, &meshData->m_VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, meshData->m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, meshData->verticesSize(), meshData->vertices().data(), GL_STATIC_DRAW);
+
+    if (meshData->m_layout == VertexLayout::Split) {
+        glGenBuffers(1, &meshData->m_positionVBO);
+    }
+
+    const auto buffers = meshData->streamBuffers();
+
+    for (size_t i = 0; i < streams.size(); i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, streams[i].size(), streams[i].data(), GL_STATIC_DRAW);
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     glGenBuffers(1, &meshData->m_EBO);
@@ -147,4 +255,90 @@ void MeshData::createBuffers(const std::shared_ptr<MeshData> &meshData) {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
+std::vector<std::vector<unsigned char>> MeshData::encodeVertices() const {
+    const VertexFormat& format = vertexFormat();
+    const size_t vertexSize = VertexFormat::standard().strides[0] / sizeof(float);
+    const size_t vertexCount = m_vertices.size() / vertexSize;
+
+    std::vector<std::vector<unsigned char>> streams;
+
+    for (const int stride : format.strides) {
+        streams.emplace_back(vertexCount * stride);
+    }
+
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float* vertex = m_vertices.data() + i * vertexSize;
+
+        for (const auto& attribute : format.attributes) {
+            unsigned char* target = streams[attribute.stream].data() + i * format.strides[attribute.stream] + attribute.offset;
+            encodeAttribute(attribute, vertex, target);
+        }
+    }
+
+    return streams;
+}
+
+void MeshData::encodeAttribute(const VertexAttribute& attribute, const float* vertex, unsigned char* target) const {
+    const auto& standardAttributes = VertexFormat::standard().attributes;
+    const auto standardAttribute = std::ranges::find(standardAttributes, attribute.location, &VertexAttribute::location);
+
+    const float* source = vertex + standardAttribute->offset / sizeof(float);
+
+    uint16_t values[4];
+
+    switch (attribute.type) {
+        case GL_FLOAT:
+            std::memcpy(target, source, attribute.size * sizeof(float));
+            return;
+
+        // positions normalized to the mesh bounds
+        case GL_UNSIGNED_SHORT:
+            for (int i = 0; i < attribute.size; i++) {
+                const float scale = m_positionScale[i];
+                values[i] = glm::packUnorm1x16(scale > 0 ? (source[i] - m_positionOffset[i]) / scale : 0.f);
+            }
+            break;
+
+        case GL_HALF_FLOAT:
+            for (int i = 0; i < attribute.size; i++) {
+                values[i] = glm::packHalf1x16(source[i]);
+            }
+            break;
+
+        // octahedral encoded normals
+        case GL_SHORT: {
+            const glm::vec2 encoded = encodeOctahedral(glm::vec3(source[0], source[1], source[2]));
+            values[0] = glm::packSnorm1x16(encoded.x);
+            values[1] = glm::packSnorm1x16(encoded.y);
+            break;
+        }
+
+        default:
+            throw std::runtime_error(std::format(
+                "MESH DATA. Vertex attribute type is not supported. Mesh: {}, location: {}, type: {}",
+                m_name, attribute.location, attribute.type
+            ));
+    }
+
+    std::memcpy(target, values, attribute.size * sizeof(uint16_t));
+}
+
+glm::vec2 MeshData::encodeOctahedral(glm::vec3 normal) {
+    const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+
+    if (length == 0) {
+        return glm::vec2(0);
+    }
+
+    normal /= length;
+
+    if (normal.z >= 0) {
+        return glm::vec2(normal);
+    }
+
+    const glm::vec2 signNotZero(normal.x >= 0 ? 1.f : -1.f, normal.y >= 0 ? 1.f : -1.f);
+
+    return (1.f - glm::abs(glm::vec2(normal.y, normal.x))) * signNotZero;
+}
+
 }
@@ -2,19 +2,28 @@
 
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 
+#include "../render-pipeline/culling/bounds.h"
+#include "../render-pipeline/geometry/vertex_format.h"
+
 namespace SimpleGL {
 
 struct MeshData {
     ~MeshData();
 
-    static std::shared_ptr<MeshData> createFromScene(const aiScene* scene);
+    static std::shared_ptr<MeshData> createFromScene(
+        const aiScene* scene,
+        VertexLayout layout = VertexLayout::Interleaved,
+        VertexPrecision precision = VertexPrecision::Float
+    );
 
     const std::string& name() { return m_name; }
 
+    /// Interleaved vertices in the standard format, whatever the layout of the vertex buffers is
     const std::vector<float>& vertices() { return m_vertices; }
     int verticesSize() const { return sizeof(float) * m_vertices.size(); }
     bool hasVertices() const { return !m_vertices.empty(); }
@@ -22,8 +31,34 @@ struct MeshData {
     const std::vector<unsigned int>& indices() { return m_indices; }
     int indicesSize() const { return sizeof(float) * m_indices.size(); }
 
+    /// Bounds in mesh local space
+    const AABB& aabb() const { return m_aabb; }
+    const BoundingSphere& boundingSphere() const { return m_boundingSphere; }
+
+    VertexLayout layout() const { return m_layout; }
+    VertexPrecision precision() const { return m_precision; }
+
+    /// Quantized positions are decoded as offset + scale * position. Identity for float vertices
+    const glm::vec3& positionOffset() const { return m_positionOffset; }
+    const glm::vec3& positionScale() const { return m_positionScale; }
+
+    /// Format with all attributes of the layout
+    const VertexFormat& vertexFormat() const;
+
+    /// Format reading only positions, for depth and stencil passes
+    const VertexFormat& positionFormat() const;
+
+    /// Interleaved vertices, or texture coordinates and normals in the split layout
     unsigned int VBO() const { return m_VBO; }
+    /// Positions in the split layout, 0 otherwise
+    unsigned int positionVBO() const { return m_positionVBO; }
     unsigned int EBO() const { return m_EBO; }
+    /// Instance world matrices read by VAOs of VertexFormat::instanced formats, 0 until the first such VAO is created.
+    /// Filled by the caller before every instanced draw
+    unsigned int instanceVBO() const { return m_instanceVBO; }
+
+    /// VAO reading the buffers in format, created on the first call and shared by all meshes drawing this data
+    unsigned int VAO(const VertexFormat& format);
 
     const std::vector<std::shared_ptr<MeshData>>& subMeshes() { return m_subMeshes; }
 
@@ -35,15 +70,46 @@ private:
 
     std::vector<std::shared_ptr<MeshData>> m_subMeshes{};
 
+    AABB m_aabb;
+    BoundingSphere m_boundingSphere;
+
+    VertexLayout m_layout = VertexLayout::Interleaved;
+    VertexPrecision m_precision = VertexPrecision::Float;
+
+    glm::vec3 m_positionOffset = glm::vec3(0);
+    glm::vec3 m_positionScale = glm::vec3(1);
+
     unsigned int m_VBO = 0;
+    unsigned int m_positionVBO = 0;
     unsigned int m_EBO = 0;
+    unsigned int m_instanceVBO = 0;
+
+    /// VAOs by vertex format id
+    std::unordered_map<unsigned int, unsigned int> m_VAOs;
+
+    /// Vertex buffers in the order of the layout's streams
+    std::vector<unsigned int> streamBuffers() const;
 
-    static std::shared_ptr<MeshData> parseScene(const aiScene* scene);
+    /// Encodes standard vertices into the streams of the vertex format
+    std::vector<std::vector<unsigned char>> encodeVertices() const;
 
-    static void fillMeshData(const aiMesh* mesh, const std::shared_ptr<MeshData>& meshData);
+    void encodeAttribute(const VertexAttribute& attribute, const float* vertex, unsigned char* target) const;
+
+    static glm::vec2 encodeOctahedral(glm::vec3 normal);
+
+    static std::shared_ptr<MeshData> parseScene(const aiScene* scene, VertexLayout layout, VertexPrecision precision);
+
+    static void fillMeshData(
+        const aiMesh* mesh,
+        const std::shared_ptr<MeshData>& meshData,
+        VertexLayout layout,
+        VertexPrecision precision
+    );
 
     static unsigned int calculateVertexSize(const aiMesh* mesh);
 
+    static void calculateBounds(const aiMesh* mesh, const std::shared_ptr<MeshData>& meshData);
+
     static void createBuffers(const std::shared_ptr<MeshData>& meshData);
 };
 
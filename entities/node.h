@@ -20,6 +20,8 @@ public:
 
     std::string name;
     bool visible = true;
+    /// Marks the whole subtree as rarely moving. Such meshes are kept in a separately optimized spatial index tree
+    bool isStatic = false;
 
     static std::shared_ptr<Node> create(
         const std::string& name = "Node",
@@ -4,13 +4,24 @@
 
 #include "node.h"
 #include "components/light.h"
+#include "components/mesh.h"
 #include "components/transform.h"
+#include "../render-pipeline/culling/spatial_index.h"
+#include "../render-pipeline/lighting/clustered_lighting.h"
 
 namespace SimpleGL {
 
+Scene::Scene() = default;
+
+Scene::~Scene() = default;
+
 void Scene::start() {
+    m_spatialIndex = std::make_unique<SpatialIndex>();
+
     processComponents();
 
+    m_clusteredLighting = std::make_unique<ClusteredLighting>();
+
     for (const std::weak_ptr<Component>& component : m_componentsMap | std::views::values) {
         component.lock()->onStart();
     }
@@ -38,6 +49,10 @@ void Scene::processComponents() {
             if (const std::shared_ptr<DirectLight>& directLight = std::dynamic_pointer_cast<DirectLight>(component)) {
                 m_directLights.push_back(directLight);
             }
+
+            if (const std::shared_ptr<MeshComponent>& mesh = std::dynamic_pointer_cast<MeshComponent>(component)) {
+                m_spatialIndex->add(mesh);
+            }
         }
     });
 }
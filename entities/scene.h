@@ -11,15 +11,23 @@ class Node;
 class Light;
 class DirectLight;
 class PointLight;
+class ClusteredLighting;
+class SpatialIndex;
 
 class Scene {
 public:
+    Scene();
+    ~Scene();
+
     const std::shared_ptr<Node>& rootNode() const { return m_rootNode; }
     void setRootNode(const std::shared_ptr<Node> &rootNode) { m_rootNode = rootNode; }
 
     const std::vector<std::weak_ptr<DirectLight>>& directLights() const { return m_directLights; }
     const std::vector<std::weak_ptr<PointLight>>& pointLights() const { return m_pointLights; }
 
+    const std::unique_ptr<ClusteredLighting>& clusteredLighting() const { return m_clusteredLighting; }
+    const std::unique_ptr<SpatialIndex>& spatialIndex() const { return m_spatialIndex; }
+
     void start();
     void update();
 
@@ -30,6 +38,9 @@ private:
     std::vector<std::weak_ptr<DirectLight>> m_directLights;
     std::vector<std::weak_ptr<PointLight>> m_pointLights;
 
+    std::unique_ptr<ClusteredLighting> m_clusteredLighting;
+    std::unique_ptr<SpatialIndex> m_spatialIndex;
+
     void processComponents();
 };
 
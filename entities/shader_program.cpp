@@ -12,6 +12,8 @@
 #include "components/transform.h"
 #include "../managers/engine.h"
 #include "../entities/texture.h"
+#include "../render-pipeline/deferred/deferred_renderer.h"
+#include "../render-pipeline/lighting/clustered_lighting.h"
 
 namespace SimpleGL {
 
@@ -25,16 +27,20 @@ ShaderProgram::ShaderProgram(unsigned int id, std::string label):
 }
 
 void ShaderProgram::use(const std::shared_ptr<Camera> &camera) {
+    // clusters may be assigned by a compute program, so they are built before this program is made current
+    updateClusteredLights(camera);
+
     if (activeShaderProgramId != id) {
         activeShaderProgramId = id;
         glUseProgram(id);
 
         setDirectLightsUniform();
-        setPointLightsUniform();
     }
 
-    setCameraUniforms(camera);
     m_boundTexturesCount = 0;
+    setCameraUniforms(camera);
+    setClusteredLightsUniforms(camera);
+    setDeferredUniforms(camera);
 }
 
 void ShaderProgram::log() const {
@@ -108,6 +114,18 @@ void ShaderProgram::setUniform(const std::string &name, const glm::mat4 &matrix)
     glUniformMatrix4fv(getUniform(name)->location, 1, false, glm::value_ptr(matrix));
 }
 
+void ShaderProgram::setUniform(const std::string &name, const std::vector<glm::mat4> &matrices) {
+    glUniformMatrix4fv(getUniform(name)->location, static_cast<int>(matrices.size()), false, glm::value_ptr(matrices[0]));
+}
+
+void ShaderProgram::setUniform(const std::string &name, const std::vector<glm::vec3> &vectors) {
+    glUniform3fv(getUniform(name)->location, static_cast<int>(vectors.size()), glm::value_ptr(vectors[0]));
+}
+
+void ShaderProgram::setUniform(const std::string &name, const std::vector<glm::vec4> &vectors) {
+    glUniform4fv(getUniform(name)->location, static_cast<int>(vectors.size()), glm::value_ptr(vectors[0]));
+}
+
 bool ShaderProgram::uniformExists(const std::string &name) {
     const auto iterator = m_uniformsMap.find(name);
     return iterator != m_uniformsMap.end();
@@ -207,7 +225,7 @@ void ShaderProgram::setCameraUniforms(const std::shared_ptr<Camera> &camera) {
     }
 
     if (uniformExists("viewPosition")) {
-        setUniform("viewPosition", camera->transform()->position());
+        setUniform("viewPosition", camera->position());
     }
 }
 
@@ -229,22 +247,27 @@ void ShaderProgram::setDirectLightsUniform() {
     }
 }
 
-void ShaderProgram::setPointLightsUniform() {
+void ShaderProgram::updateClusteredLights(const std::shared_ptr<Camera> &camera) {
     const auto scene = Engine::get()->scene();
 
-    if (uniformExists("pointLightsNum")) {
-        for (int i = 0; i < scene->pointLights().size(); i++) {
-            const auto light = scene->pointLights()[i].lock();
-            auto index_str = std::to_string(i);
+    if (uniformExists("clusterParams") && scene->clusteredLighting()) {
+        scene->clusteredLighting()->update(camera);
+    }
+}
 
-            setUniform("pointLights[" + index_str + "].position", light->transform()->position());
-            setUniform("pointLights[" + index_str + "].distance", light->distance);
-            setUniform("pointLights[" + index_str + "].ambient", light->ambient);
-            setUniform("pointLights[" + index_str + "].diffuse", light->diffuse);
-            setUniform("pointLights[" + index_str + "].specular", light->specular);
-        }
+void ShaderProgram::setClusteredLightsUniforms(const std::shared_ptr<Camera> &camera) {
+    const auto scene = Engine::get()->scene();
+
+    if (uniformExists("clusterParams") && scene->clusteredLighting()) {
+        scene->clusteredLighting()->bind(*this, camera);
+    }
+}
+
+void ShaderProgram::setDeferredUniforms(const std::shared_ptr<Camera> &camera) {
+    const auto deferredRenderer = DeferredRenderer::active();
 
-        setUniform("pointLightsNum", static_cast<int>(scene->pointLights().size()));
+    if (uniformExists("viewIndex") && deferredRenderer != nullptr) {
+        setUniform("viewIndex", deferredRenderer->registerView(camera));
     }
 }
 
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -34,6 +36,12 @@ public:
 
     void log() const;
 
+    /// Variant of this program writing material attributes to the g-buffer. Null if the shader has no such variant.
+    const std::shared_ptr<ShaderProgram>& gBufferVariant() const { return m_gBufferVariant; }
+    void setGBufferVariant(const std::shared_ptr<ShaderProgram>& variant) { m_gBufferVariant = variant; }
+
+    const std::unordered_map<std::string, std::shared_ptr<ShaderParam>>& attribs() const { return m_attribsMap; }
+
     int getAttribLocation(const std::string& name);
 
     void setTexture(const std::string& name, const std::shared_ptr<Texture>& texture);
@@ -46,6 +54,21 @@ public:
     void setUniform(const std::string& name, int x);
     void setUniform(const std::string& name, float x);
     void setUniform(const std::string &name, const glm::mat4& matrix);
+    /// name must be name of the array's first element, e.g. "matrices[0]"
+    void setUniform(const std::string &name, const std::vector<glm::mat4>& matrices);
+    void setUniform(const std::string &name, const std::vector<glm::vec3>& vectors);
+    void setUniform(const std::string &name, const std::vector<glm::vec4>& vectors);
+
+    /// Tracks which material parameters are currently uploaded, see Material::apply.
+    /// Must be reset with id 0 after uniforms are set directly, e.g. by draw callbacks
+    bool isMaterialApplied(unsigned int materialId, uint64_t version) const {
+        return m_appliedMaterialId == materialId && m_appliedMaterialVersion == version;
+    }
+
+    void setAppliedMaterial(unsigned int materialId, uint64_t version = 0) {
+        m_appliedMaterialId = materialId;
+        m_appliedMaterialVersion = version;
+    }
 
     bool uniformExists(const std::string& name);
     bool attribExists(const std::string& name);
@@ -57,6 +80,11 @@ private:
     std::unordered_map<std::string, std::shared_ptr<ShaderParam>> m_attribsMap;
     int m_boundTexturesCount = 0;
 
+    unsigned int m_appliedMaterialId = 0;
+    uint64_t m_appliedMaterialVersion = 0;
+
+    std::shared_ptr<ShaderProgram> m_gBufferVariant;
+
     void processProgram();
 
     void processUniforms();
@@ -71,7 +99,9 @@ private:
 
     void setCameraUniforms(const std::shared_ptr<Camera> &camera);
     void setDirectLightsUniform();
-    void setPointLightsUniform();
+    void updateClusteredLights(const std::shared_ptr<Camera> &camera);
+    void setClusteredLightsUniforms(const std::shared_ptr<Camera> &camera);
+    void setDeferredUniforms(const std::shared_ptr<Camera> &camera);
 };
 
 }
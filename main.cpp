@@ -1,8 +1,12 @@
+#include <format>
 #include <sstream>
 #include <memory>
+#include <string_view>
 
 #include "demos/basic_demo.h"
 #include "managers/engine.h"
+#include "managers/shader_manager.h"
+#include "render-pipeline/state/gl_state_cache.h"
 #include "window/window.h"
 #include "window/input.h"
 #include "window/window_panel.h"
@@ -12,7 +16,7 @@
 
 using namespace SimpleGL;
 
-int main() {
+int main(const int argc, char** argv) {
     constexpr int MSAA_SAMPLES = 4;
     constexpr bool HDR_ENABLED = true;
     constexpr int SCREEN_WIDTH = 1200;
@@ -30,7 +34,13 @@ int main() {
     windowPanelSettings.msaaSamples = MSAA_SAMPLES;
     const auto& panel = std::make_unique<WindowPanel>(windowPanelPosition, windowPanelSettings);
 
-    auto demo = BasicDemo();
+    // "--night-lights" stresses clustered lighting with a few hundred point lights
+    bool nightLights = false;
+    for (int i = 1; i < argc; i++) {
+        nightLights |= std::string_view(argv[i]) == "--night-lights";
+    }
+
+    auto demo = BasicDemo(nightLights);
     const auto drawCallback = [&demo]() { demo.draw(); };
 
     demo.scene->start();
@@ -44,6 +54,9 @@ int main() {
             window->close();
         }
 
+        // finishes programs compiled in the background
+        Engine::get()->shaderManager()->update();
+
         demo.scene->update();
         demo.stepPhysicsSimulation();
         demo.scene->rootNode()->transform()->recalculate();
@@ -51,6 +64,16 @@ int main() {
 
         panel->renderToFrame(drawCallback);
         panel->renderToScreen();
+
+        if (window->input()->frameIndex() % 60 == 0) {
+            const auto& glState = Engine::get()->glState();
+
+            window->setTitle(std::format(
+                "Learn OpenGL | GL state calls: {}, redundant dropped: {}",
+                glState->callsLastFrame(),
+                glState->redundantCallsLastFrame()
+            ));
+        }
     }
 
     return 0;
@@ -4,7 +4,9 @@
 #include "mesh_manager.h"
 #include "physics_manager.h"
 #include "texture_manager.h"
+#include "job_manager.h"
 #include "../window/window.h"
+#include "../render-pipeline/state/gl_state_cache.h"
 
 namespace SimpleGL {
 
@@ -20,10 +22,14 @@ Engine::Engine() {
     m_meshManager = std::make_unique<MeshManager>();
     m_textureManager = std::make_unique<TextureManager>();
     m_physicsManager = std::make_unique<PhysicsManager>();
+    m_jobManager = std::make_unique<JobManager>();
+    m_glState = std::make_unique<GLStateCache>();
 }
 
 Engine::~Engine() {
     m_scene.reset();
+    m_glState.reset();
+    m_jobManager.reset();
     m_physicsManager.reset();
     m_textureManager.reset();
     m_meshManager.reset();
@@ -10,6 +10,8 @@ class ShaderManager;
 class MeshManager;
 class TextureManager;
 class PhysicsManager;
+class JobManager;
+class GLStateCache;
 class Input;
 class Scene;
 class Node;
@@ -30,6 +32,8 @@ public:
     const std::unique_ptr<MeshManager>& meshManager() { return m_meshManager; }
     const std::unique_ptr<TextureManager>& textureManager() { return m_textureManager; }
     const std::unique_ptr<PhysicsManager>& physicsManager() { return m_physicsManager; }
+    const std::unique_ptr<JobManager>& jobManager() { return m_jobManager; }
+    const std::unique_ptr<GLStateCache>& glState() { return m_glState; }
 
     std::shared_ptr<Scene> scene() const { return m_scene.lock(); }
     void setScene(const std::shared_ptr<Scene>& scene) { m_scene = scene; }
@@ -46,6 +50,8 @@ private:
     std::unique_ptr<MeshManager> m_meshManager;
     std::unique_ptr<TextureManager> m_textureManager;
     std::unique_ptr<PhysicsManager> m_physicsManager;
+    std::unique_ptr<JobManager> m_jobManager;
+    std::unique_ptr<GLStateCache> m_glState;
 
     std::weak_ptr<Scene> m_scene;
 };
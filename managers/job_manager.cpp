@@ -0,0 +1,128 @@
+#include "job_manager.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace SimpleGL {
+
+JobManager::JobManager() {
+    const unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 2u);
+
+    // one thread is left for the main thread
+    for (unsigned int i = 0; i < hardwareThreads - 1; i++) {
+        m_workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+JobManager::~JobManager() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void JobManager::parallelFor(
+    unsigned int count,
+    unsigned int minChunkSize,
+    const std::function<void(unsigned int begin, unsigned int end)>& callback
+) {
+    if (count == 0) {
+        return;
+    }
+
+    // a zero chunk size means chunks of any size
+    const unsigned int chunkSizeLimit = std::max(minChunkSize, 1u);
+    const unsigned int maxChunksCount = (count + chunkSizeLimit - 1) / chunkSizeLimit;
+    const unsigned int chunksCount = std::clamp(threadsCount() * 4, 1u, maxChunksCount);
+
+    if (chunksCount == 1) {
+        callback(0, count);
+        return;
+    }
+
+    // shared state outlives this call in case a worker picks up its job after all chunks are claimed
+    struct State {
+        std::atomic<unsigned int> nextChunk = 0;
+        std::atomic<unsigned int> doneChunks = 0;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+
+    const auto state = std::make_shared<State>();
+    const unsigned int chunkSize = (count + chunksCount - 1) / chunksCount;
+
+    const auto processChunks = [state, count, chunkSize, chunksCount, &callback]() {
+        unsigned int chunk;
+
+        while ((chunk = state->nextChunk.fetch_add(1)) < chunksCount) {
+            const unsigned int begin = chunk * chunkSize;
+            const unsigned int end = std::min(begin + chunkSize, count);
+
+            if (begin < end) {
+                callback(begin, end);
+            }
+
+            if (state->doneChunks.fetch_add(1) + 1 == chunksCount) {
+                std::lock_guard lock(state->mutex);
+                state->condition.notify_all();
+            }
+        }
+    };
+
+    const unsigned int helpersCount = std::min(static_cast<unsigned int>(m_workers.size()), chunksCount - 1);
+
+    for (unsigned int i = 0; i < helpersCount; i++) {
+        enqueue(processChunks);
+    }
+
+    processChunks();
+
+    std::unique_lock lock(state->mutex);
+    state->condition.wait(lock, [&state, chunksCount]() { return state->doneChunks == chunksCount; });
+}
+
+std::future<void> JobManager::submit(std::function<void()> job) {
+    const auto task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+    auto result = task->get_future();
+
+    enqueue([task]() { (*task)(); });
+
+    return result;
+}
+
+void JobManager::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_jobs.push(std::move(job));
+    }
+
+    m_condition.notify_one();
+}
+
+void JobManager::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+
+            if (m_stopping && m_jobs.empty()) {
+                return;
+            }
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop();
+        }
+
+        job();
+    }
+}
+
+}
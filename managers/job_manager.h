@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace SimpleGL {
+
+/// Fixed pool of worker threads used by CPU-heavy render passes (light clustering, culling)
+class JobManager {
+public:
+    JobManager();
+    ~JobManager();
+
+    /// Number of threads that take part in parallelFor, including the calling thread
+    unsigned int threadsCount() const { return static_cast<unsigned int>(m_workers.size()) + 1; }
+
+    /// Splits [0, count) into chunks of at least minChunkSize elements and runs
+    /// callback(begin, end) for each of them. The calling thread also processes chunks.
+    /// Blocks until every chunk is done.
+    void parallelFor(
+        unsigned int count,
+        unsigned int minChunkSize,
+        const std::function<void(unsigned int begin, unsigned int end)>& callback
+    );
+
+    /// Runs job on a worker thread. Must not be used for jobs that wait on other jobs.
+    std::future<void> submit(std::function<void()> job);
+
+private:
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_jobs;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+
+    void enqueue(std::function<void()> job);
+
+    void workerLoop();
+};
+
+}
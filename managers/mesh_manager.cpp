@@ -11,9 +11,22 @@
 #include "../entities/node.h"
 #include "../entities/components/mesh.h"
 #include "../entities/mesh_data.h"
+#include "../render-pipeline/geometry/geometry_buffer.h"
 
 namespace SimpleGL {
 
+MeshManager::MeshManager() = default;
+
+MeshManager::~MeshManager() = default;
+
+const std::unique_ptr<GeometryBuffer>& MeshManager::geometryBuffer() {
+    if (m_geometryBuffer == nullptr) {
+        m_geometryBuffer = std::make_unique<GeometryBuffer>();
+    }
+
+    return m_geometryBuffer;
+}
+
 std::shared_ptr<MeshData> MeshManager::loadMeshData(const std::filesystem::path &path) {
     const auto resourcePath = Engine::get()->getResourcePath(path);
 
@@ -38,7 +51,7 @@ std::shared_ptr<MeshData> MeshManager::loadMeshData(const std::filesystem::path
         ));
     }
 
-    const auto meshData = MeshData::createFromScene(scene);
+    const auto meshData = MeshData::createFromScene(scene, vertexLayout, vertexPrecision);
 
     m_meshes[resourcePath] = meshData;
 
@@ -5,14 +5,26 @@
 #include <unordered_map>
 #include <filesystem>
 
+#include "../render-pipeline/geometry/vertex_format.h"
+
 namespace SimpleGL {
 
 class Node;
 class Component;
+class GeometryBuffer;
 struct MeshData;
 
 class MeshManager {
 public:
+    /// Layout of vertex buffers of meshes loaded afterwards. Already loaded meshes keep theirs
+    VertexLayout vertexLayout = VertexLayout::Interleaved;
+
+    /// Encoding of vertex attributes of meshes loaded afterwards, chosen per mesh at import time
+    VertexPrecision vertexPrecision = VertexPrecision::Float;
+
+    MeshManager();
+    ~MeshManager();
+
     std::shared_ptr<MeshData> loadMeshData(const std::filesystem::path& path);
 
     void freeMeshData(const std::filesystem::path& path);
@@ -22,8 +34,12 @@ public:
         const std::shared_ptr<Node>& parent = nullptr
     );
 
+    /// Shared vertex and index buffers for batched draws. Created on the first call, as it needs an OpenGL context
+    const std::unique_ptr<GeometryBuffer>& geometryBuffer();
+
 private:
     std::unordered_map<std::string, std::shared_ptr<MeshData>> m_meshes;
+    std::unique_ptr<GeometryBuffer> m_geometryBuffer;
 };
 
 }
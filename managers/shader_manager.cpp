@@ -4,6 +4,7 @@ TODO: This code contains memory leaks on error paths
 
 #include "shader_manager.h"
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -13,7 +14,28 @@ TODO: This code contains memory leaks on error paths
 
 namespace SimpleGL {
 
+ShaderProgramHandle::ShaderProgramHandle(std::string label, const std::shared_ptr<ShaderProgram>& fallback):
+    label(std::move(label)),
+    m_fallback(fallback)
+{}
+
+const std::shared_ptr<ShaderProgram>& ShaderProgramHandle::wait() {
+    if (!isReady()) {
+        Engine::get()->shaderManager()->finish(*this);
+    }
+
+    return m_program;
+}
+
 ShaderManager::~ShaderManager() {
+    for (const auto& pending : this->m_pendingPrograms) {
+        glDeleteProgram(pending.job.programID);
+
+        for (const unsigned int shaderID : pending.job.shaderIDs) {
+            glDeleteShader(shaderID);
+        }
+    }
+
     for (const auto& shaderProgram : this->m_shaderPrograms) {
         glDeleteProgram(shaderProgram->id);
     }
@@ -24,45 +46,271 @@ ShaderManager::~ShaderManager() {
 std::shared_ptr<ShaderProgram> ShaderManager::createShaderProgram(
     const std::filesystem::path& vertexShaderFile,
     const std::filesystem::path& fragmentShaderFile,
+    const std::string& label,
+    unsigned int features
+)
+{
+    return createShaderProgramAsync(vertexShaderFile, fragmentShaderFile, label, features)->wait();
+}
+
+std::shared_ptr<ShaderProgramHandle> ShaderManager::createShaderProgramAsync(
+    const std::filesystem::path& vertexShaderFile,
+    const std::filesystem::path& fragmentShaderFile,
+    const std::string& label,
+    unsigned int features,
+    const std::shared_ptr<ShaderProgram>& fallback
+) {
+    const std::string variantKey = std::format("{}|{}|{}", vertexShaderFile.string(), fragmentShaderFile.string(), features);
+
+    if (const auto it = m_variants.find(variantKey); it != m_variants.end()) {
+        return it->second;
+    }
+
+    std::vector sources = {
+        readShaderSource(vertexShaderFile, GL_VERTEX_SHADER, features),
+        readShaderSource(fragmentShaderFile, GL_FRAGMENT_SHADER, features)
+    };
+
+    const auto gBufferFragmentShaderFile =
+        fragmentShaderFile.parent_path() / ("gbuffer-" + fragmentShaderFile.filename().string());
+
+    if (std::filesystem::exists(Engine::get()->getResourcePath(gBufferFragmentShaderFile))) {
+        sources.push_back(readShaderSource(gBufferFragmentShaderFile, GL_FRAGMENT_SHADER, features));
+    }
+
+    const uint64_t sourcesHash = hashSources(sources);
+
+    const auto pendingIt = std::ranges::find(m_pendingPrograms, sourcesHash, &PendingProgram::sourcesHash);
+
+    if (pendingIt != m_pendingPrograms.end()) {
+        m_variants[variantKey] = pendingIt->handle;
+        return pendingIt->handle;
+    }
+
+    auto handle = std::make_shared<ShaderProgramHandle>(label, fallback);
+    m_variants[variantKey] = handle;
+
+    if (const auto it = m_programsBySources.find(sourcesHash); it != m_programsBySources.end()) {
+        handle->m_program = it->second;
+        return handle;
+    }
+
+    auto job = submitLink({ sources[0], sources[1] }, label);
+
+    m_pendingPrograms.push_back({ handle, sourcesHash, std::move(sources), std::move(job), nullptr });
+
+    return handle;
+}
+
+void ShaderManager::update() {
+    // a finished program may submit its g-buffer variant, which is checked on the next update
+    std::erase_if(m_pendingPrograms, [this](PendingProgram& pending) {
+        return isLinkComplete(pending.job) && advance(pending);
+    });
+}
+
+std::shared_ptr<ShaderProgram> ShaderManager::createComputeProgram(
+    const std::filesystem::path& computeShaderFile,
+    const std::string& label
+) {
+#ifdef GL_VERSION_4_3
+    const std::vector sources = { readShaderSource(computeShaderFile, GL_COMPUTE_SHADER) };
+    const uint64_t sourcesHash = hashSources(sources);
+
+    if (const auto it = m_programsBySources.find(sourcesHash); it != m_programsBySources.end()) {
+        return it->second;
+    }
+
+    auto shaderProgram = addShaderProgram(linkShaderProgram(sources, label), label);
+
+    m_programsBySources[sourcesHash] = shaderProgram;
+
+    return shaderProgram;
+#else
+    throw std::runtime_error(std::format(
+        "SHADER MANAGER. Compute shaders require OpenGL 4.3. Label: {}",
+        label
+    ));
+#endif
+}
+
+unsigned int ShaderManager::linkShaderProgram(
+    const std::vector<ShaderSource>& sources,
     const std::string& label
 )
 {
-    const unsigned int shaderProgramID = glCreateProgram();
+    return finishLink(submitLink(sources, label));
+}
+
+ShaderManager::LinkJob ShaderManager::submitLink(
+    const std::vector<ShaderSource>& sources,
+    const std::string& label,
+    const std::vector<std::pair<std::string, int>>& attribLocations
+)
+{
+    LinkJob job;
+    job.label = label;
+
+    const bool cacheEnabled = isCacheEnabled();
+
+    if (cacheEnabled) {
+        uint64_t key = hashSources(sources, hash(m_driverVersion));
+
+        for (const auto& [name, location] : attribLocations) {
+            key = hash(std::format("{}={};", name, location), key);
+        }
+
+        job.cacheFile = cacheDirectory / std::format("{:016x}.bin", key);
+        job.programID = loadProgramBinary(job.cacheFile);
+
+        if (job.programID != 0) {
+            return job;
+        }
+    }
+
+    // compilation of all shaders runs in the driver until the status is queried
+    isParallelCompileSupported();
 
-    if (shaderProgramID == 0) {
+    job.programID = glCreateProgram();
+
+    if (job.programID == 0) {
         throw std::runtime_error(std::format(
             "SHADER MANAGER. glCreateProgram. Label: {}\n",
             label
         ));
     }
 
-    const auto vertexShaderFilepath = Engine::get()->getResourcePath(vertexShaderFile);
-    const auto vertexShaderID = createShader(label, vertexShaderFilepath, GL_VERTEX_SHADER);
+    if (cacheEnabled) {
+        glProgramParameteri(job.programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    for (const auto& source : sources) {
+        const unsigned int shaderID = createShader(label, source);
+
+        glAttachShader(job.programID, shaderID);
+        job.shaderIDs.push_back(shaderID);
+    }
+
+    for (const auto& [name, location] : attribLocations) {
+        glBindAttribLocation(job.programID, location, name.c_str());
+    }
 
-    const auto fragmentShaderFilepath = Engine::get()->getResourcePath(fragmentShaderFile);
-    const auto fragmentShaderID = createShader(label, fragmentShaderFilepath, GL_FRAGMENT_SHADER);
+    glLinkProgram(job.programID);
 
-    glAttachShader(shaderProgramID, vertexShaderID);
-    glAttachShader(shaderProgramID, fragmentShaderID);
+    return job;
+}
 
-    glLinkProgram(shaderProgramID);
+unsigned int ShaderManager::finishLink(const LinkJob& job) {
+    // loaded from the binary cache and checked already
+    if (job.shaderIDs.empty()) {
+        return job.programID;
+    }
 
     int success;
-    glGetProgramiv(shaderProgramID, GL_LINK_STATUS, &success);
+    glGetProgramiv(job.programID, GL_LINK_STATUS, &success);
 
     if (!success) {
-        char log[512];
-        glGetProgramInfoLog(shaderProgramID, 512, nullptr, log);
+        throwLinkError(job);
+    }
 
-        throw std::runtime_error(std::format(
-            "SHADER MANAGER. glLinkProgram. Label: {}\nLog: {}",
-            label, log
-        ));
+    for (const unsigned int shaderID : job.shaderIDs) {
+        glDeleteShader(shaderID);
+    }
+
+    if (!job.cacheFile.empty()) {
+        saveProgramBinary(job.programID, job.cacheFile);
+    }
+
+    return job.programID;
+}
+
+bool ShaderManager::isLinkComplete(const LinkJob& job) {
+    if (job.shaderIDs.empty() || !isParallelCompileSupported()) {
+        return true;
+    }
+
+    int completed = GL_TRUE;
+
+#ifdef GL_KHR_parallel_shader_compile
+    glGetProgramiv(job.programID, GL_COMPLETION_STATUS_KHR, &completed);
+#endif
+
+    return completed == GL_TRUE;
+}
+
+bool ShaderManager::advance(PendingProgram& pending) {
+    const unsigned int programID = finishLink(pending.job);
+    auto shaderProgram = addShaderProgram(programID, pending.job.label);
+
+    if (pending.program == nullptr) {
+        pending.program = shaderProgram;
+
+        if (pending.sources.size() > 2) {
+            pending.job = submitLink(
+                { pending.sources[0], pending.sources[2] },
+                pending.handle->label + " (g-buffer)",
+                attribLocations(shaderProgram)
+            );
+
+            return false;
+        }
+    } else {
+        pending.program->setGBufferVariant(shaderProgram);
+    }
+
+    m_programsBySources[pending.sourcesHash] = pending.program;
+    pending.handle->m_program = pending.program;
+
+    return true;
+}
+
+void ShaderManager::finish(const ShaderProgramHandle& handle) {
+    const auto it = std::ranges::find_if(m_pendingPrograms, [&handle](const PendingProgram& pending) {
+        return pending.handle.get() == &handle;
+    });
+
+    if (it == m_pendingPrograms.end()) {
+        return;
+    }
+
+    while (!advance(*it)) {}
+
+    m_pendingPrograms.erase(it);
+}
+
+bool ShaderManager::isParallelCompileSupported() {
+    if (m_parallelCompileQueried) {
+        return m_parallelCompile;
+    }
+
+    m_parallelCompileQueried = true;
+
+#ifdef GL_KHR_parallel_shader_compile
+    m_parallelCompile = GLAD_GL_KHR_parallel_shader_compile;
+
+    if (m_parallelCompile) {
+        // let the driver choose the number of compiler threads
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+#endif
+
+    return m_parallelCompile;
+}
+
+std::vector<std::pair<std::string, int>> ShaderManager::attribLocations(const std::shared_ptr<ShaderProgram>& shaderProgram) {
+    std::vector<std::pair<std::string, int>> result;
+
+    for (const auto& [name, attrib] : shaderProgram->attribs()) {
+        result.emplace_back(name, attrib->location);
     }
 
-    glDeleteShader(vertexShaderID);
-    glDeleteShader(fragmentShaderID);
+    // sorted, so the binary cache key does not depend on the map order
+    std::ranges::sort(result);
 
+    return result;
+}
+
+std::shared_ptr<ShaderProgram> ShaderManager::addShaderProgram(unsigned int shaderProgramID, const std::string& label) {
     auto shaderProgram = std::make_shared<ShaderProgram>(shaderProgramID, label);
 
     this->m_shaderPrograms.push_back(shaderProgram);
@@ -70,28 +318,186 @@ std::shared_ptr<ShaderProgram> ShaderManager::createShaderProgram(
     return shaderProgram;
 }
 
+bool ShaderManager::isCacheEnabled() {
+    if (cacheDirectory.empty()) {
+        return false;
+    }
+
+    if (!m_driverVersionQueried) {
+        m_driverVersionQueried = true;
+
+        int formatsCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatsCount);
+
+        if (formatsCount > 0) {
+            m_driverVersion = std::format(
+                "{}|{}|{}",
+                reinterpret_cast<const char*>(glGetString(GL_VENDOR)),
+                reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+                reinterpret_cast<const char*>(glGetString(GL_VERSION))
+            );
+        }
+    }
+
+    return !m_driverVersion.empty();
+}
+
+unsigned int ShaderManager::loadProgramBinary(const std::filesystem::path& cacheFile) {
+    std::ifstream file(cacheFile, std::ios::binary);
+
+    if (!file) {
+        return 0;
+    }
+
+    GLenum format = 0;
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+
+    const std::vector<char> binary((std::istreambuf_iterator(file)), std::istreambuf_iterator<char>());
+
+    file.close();
+
+    const unsigned int shaderProgramID = glCreateProgram();
+
+    if (!binary.empty()) {
+        glProgramBinary(shaderProgramID, format, binary.data(), static_cast<int>(binary.size()));
+    }
+
+    int success = GL_FALSE;
+    glGetProgramiv(shaderProgramID, GL_LINK_STATUS, &success);
+
+    if (!success) {
+        // outdated or corrupted, it is replaced after the program is compiled
+        glDeleteProgram(shaderProgramID);
+
+        std::error_code error;
+        std::filesystem::remove(cacheFile, error);
+
+        return 0;
+    }
+
+    return shaderProgramID;
+}
+
+void ShaderManager::saveProgramBinary(unsigned int shaderProgramID, const std::filesystem::path& cacheFile) {
+    int length = 0;
+    glGetProgramiv(shaderProgramID, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if (length == 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(shaderProgramID, length, nullptr, &format, binary.data());
+
+    // the cache is an optimization, failing to write it is not an error
+    std::error_code error;
+    std::filesystem::create_directories(cacheFile.parent_path(), error);
+
+    std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    file.write(binary.data(), length);
+}
+
 unsigned int ShaderManager::createShader(
     const std::string &label,
-    const std::string &shaderPath,
-    const GLenum shaderType
+    const ShaderSource& source
 ) {
-    const unsigned int shaderID = glCreateShader(shaderType);
+    const unsigned int shaderID = glCreateShader(source.type);
 
     if (shaderID == 0) {
         throw std::runtime_error(std::format(
             "SHADER MANAGER. glCreateShader. Label: {}\nType: {}",
-            label, shaderType
+            label, source.type
         ));
     }
 
-    const std::string vertexShaderCode = readShaderFile(shaderPath);
-    const char* shaderCodeCStr = vertexShaderCode.c_str();
-
-    compileShader(label, shaderID, shaderCodeCStr);
+    compileShader(shaderID, source.code.c_str());
 
     return shaderID;
 }
 
+ShaderManager::ShaderSource ShaderManager::readShaderSource(
+    const std::filesystem::path& shaderFile,
+    GLenum shaderType,
+    unsigned int features
+) {
+    std::unordered_set<std::string> includedFiles;
+    std::string code = preprocess(Engine::get()->getResourcePath(shaderFile), includedFiles);
+
+    // defines must follow #version, which must be the first directive
+    const size_t versionPosition = code.find("#version");
+    const size_t definesPosition = versionPosition == std::string::npos ? 0 : code.find('\n', versionPosition) + 1;
+
+    code.insert(definesPosition, featureDefines(features));
+
+    return { shaderType, std::move(code) };
+}
+
+std::string ShaderManager::preprocess(const std::filesystem::path& filePath, std::unordered_set<std::string>& includedFiles) {
+    if (!std::filesystem::exists(filePath)) {
+        throw std::runtime_error(std::format(
+            "SHADER MANAGER. Shader file not found. Path: {}",
+            filePath.string()
+        ));
+    }
+
+    includedFiles.insert(std::filesystem::canonical(filePath).string());
+
+    std::istringstream input(readShaderFile(filePath.string()));
+    std::string result;
+    std::string line;
+
+    while (std::getline(input, line)) {
+        const size_t directiveStart = line.find_first_not_of(" \t");
+
+        if (directiveStart == std::string::npos || line.compare(directiveStart, 8, "#include") != 0) {
+            result += line;
+            result += '\n';
+            continue;
+        }
+
+        const size_t pathStart = line.find('"', directiveStart);
+        const size_t pathEnd = pathStart == std::string::npos ? std::string::npos : line.find('"', pathStart + 1);
+
+        if (pathEnd == std::string::npos) {
+            throw std::runtime_error(std::format(
+                "SHADER MANAGER. Invalid #include. Path: {}\nLine: {}",
+                filePath.string(), line
+            ));
+        }
+
+        const auto includePath = filePath.parent_path() / line.substr(pathStart + 1, pathEnd - pathStart - 1);
+
+        if (std::filesystem::exists(includePath) && includedFiles.contains(std::filesystem::canonical(includePath).string())) {
+            continue;
+        }
+
+        result += preprocess(includePath, includedFiles);
+    }
+
+    return result;
+}
+
+std::string ShaderManager::featureDefines(unsigned int features) {
+    static constexpr std::pair<ShaderFeature, const char*> featureNames[] = {
+        { LightingFeature, "LIGHTING" },
+        { TexturedFeature, "TEXTURED" },
+        { ClusteredFeature, "CLUSTERED" },
+        { InstancedFeature, "INSTANCED" },
+    };
+
+    std::string result;
+
+    for (const auto& [feature, name] : featureNames) {
+        if ((features & feature) != 0) {
+            result += std::format("#define {}\n", name);
+        }
+    }
+
+    return result;
+}
+
 std::string ShaderManager::readShaderFile(const std::string &filePath) {
     std::ifstream file(filePath);
     std::stringstream stream;
@@ -104,26 +510,62 @@ std::string ShaderManager::readShaderFile(const std::string &filePath) {
 }
 
 void ShaderManager::compileShader(
-    const std::string& label,
     const unsigned int &shaderID,
     const char *code
 ) {
+    // the status is checked after linking, so the driver does not have to finish compiling here
     glShaderSource(shaderID, 1, &code, nullptr);
     glCompileShader(shaderID);
+}
 
-    int success;
+void ShaderManager::throwLinkError(const LinkJob& job) {
+    char log[512];
 
-    glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+    for (const unsigned int shaderID : job.shaderIDs) {
+        int success;
+        glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
 
-    if (!success) {
-        char log[512];
-        glGetShaderInfoLog(shaderID, 512, nullptr, log);
+        if (!success) {
+            glGetShaderInfoLog(shaderID, 512, nullptr, log);
 
-        throw std::runtime_error(std::format(
-            "SHADER MANAGER. glCompileShader. Label: {}\Log: {}",
-            label, log
-        ));
+            throw std::runtime_error(std::format(
+                "SHADER MANAGER. glCompileShader. Label: {}\nLog: {}",
+                job.label, log
+            ));
+        }
+    }
+
+    glGetProgramInfoLog(job.programID, 512, nullptr, log);
+
+    throw std::runtime_error(std::format(
+        "SHADER MANAGER. glLinkProgram. Label: {}\nLog: {}",
+        job.label, log
+    ));
+}
+
+uint64_t ShaderManager::hashSources(const std::vector<ShaderSource>& sources, uint64_t seed) {
+    uint64_t result = seed;
+
+    for (const auto& [type, code] : sources) {
+        // type and length separate the sources, so different splits of the same text do not collide
+        result = hash(std::format("{}:{}:", type, code.size()), result);
+        result = hash(code, result);
+    }
+
+    return result;
+}
+
+uint64_t ShaderManager::hash(const std::string& data, uint64_t seed) {
+    constexpr uint64_t prime = 1099511628211ull;
+
+    uint64_t result = seed;
+
+    for (const char byte : data) {
+        result ^= static_cast<unsigned char>(byte);
+        result *= prime;
     }
+
+    return result;
 }
 
 }
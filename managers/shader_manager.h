@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <filesystem>
 #include <memory>
@@ -11,33 +14,198 @@ namespace SimpleGL {
 
 class ShaderProgram;
 
+/// Feature defines of shader variants, combined into a bitmask.
+/// Each feature is defined in the sources by its name in upper case, e.g. TexturedFeature as TEXTURED
+enum ShaderFeature : unsigned int {
+    /// Direct lights
+    LightingFeature = 1 << 0,
+    /// Diffuse and specular textures instead of a uniform color
+    TexturedFeature = 1 << 1,
+    /// Point lights from ClusteredLighting
+    ClusteredFeature = 1 << 2,
+    /// World matrix from the instance attribute at VertexFormat::INSTANCE_TRANSFORM_LOCATION instead of a uniform,
+    /// see MeshComponent::drawInstanced
+    InstancedFeature = 1 << 3,
+};
+
+/// Program being compiled in the background, see ShaderManager::createShaderProgramAsync
+class ShaderProgramHandle {
+public:
+    const std::string label;
+
+    ShaderProgramHandle(std::string label, const std::shared_ptr<ShaderProgram>& fallback);
+
+    bool isReady() const { return m_program != nullptr; }
+
+    /// Linked program, or the fallback until it is ready
+    const std::shared_ptr<ShaderProgram>& program() const { return m_program != nullptr ? m_program : m_fallback; }
+
+    /// Blocks until the program is linked. Throws if it fails to compile or link
+    const std::shared_ptr<ShaderProgram>& wait();
+
+private:
+    friend class ShaderManager;
+
+    std::shared_ptr<ShaderProgram> m_program;
+    std::shared_ptr<ShaderProgram> m_fallback;
+};
+
+/// Creates shader programs from GLSL files in resources.
+/// Programs are deduplicated by their sources: requesting the same sources again returns the existing program.
+/// Linked binaries are cached in cacheDirectory, keyed by a hash of the sources, bound attribute locations and
+/// the driver version, and loaded with glProgramBinary on the next launch. A binary rejected by the driver,
+/// e.g. after a driver update, is deleted and the program is compiled from the sources.
+/// Sources are preprocessed: #include "file" is replaced with the file, resolved relative to the including one and
+/// included once per source, and defines of the requested features are inserted after #version.
+/// Variants are built on demand and cached by their files and feature bitmask.
+/// Compile and link status are queried only when a program is finished, so the driver may compile all submitted programs
+/// at once. With KHR_parallel_shader_compile, update finishes only programs the driver has completed, never waiting.
 class ShaderManager {
 public:
+    /// Relative to the working directory. Empty disables the binary cache
+    std::filesystem::path cacheDirectory = "shader-cache";
+
     ShaderManager() = default;
     ~ShaderManager();
 
+    /// If a "gbuffer-<fragment file name>" shader exists next to the fragment shader,
+    /// it is linked too and set as the program's g-buffer variant
     std::shared_ptr<ShaderProgram> createShaderProgram(
         const std::filesystem::path& vertexShaderFile,
         const std::filesystem::path& fragmentShaderFile,
+        const std::string& label,
+        unsigned int features = 0
+    );
+
+    /// Submits the program for compilation and returns immediately. The handle becomes ready in update or wait.
+    /// fallback is returned by the handle in the meantime. Same sources being compiled share the first handle
+    std::shared_ptr<ShaderProgramHandle> createShaderProgramAsync(
+        const std::filesystem::path& vertexShaderFile,
+        const std::filesystem::path& fragmentShaderFile,
+        const std::string& label,
+        unsigned int features = 0,
+        const std::shared_ptr<ShaderProgram>& fallback = nullptr
+    );
+
+    /// Finishes submitted programs. Call once per frame.
+    /// Without parallel compile support the driver can't report completion, so all of them are finished, possibly waiting
+    void update();
+
+    std::shared_ptr<ShaderProgram> createComputeProgram(
+        const std::filesystem::path& computeShaderFile,
         const std::string& label
     );
 
 private:
+    friend class ShaderProgramHandle;
+
+    static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+    struct ShaderSource {
+        GLenum type;
+        std::string code;
+    };
+
+    /// Program whose link was submitted and whose status is not checked yet
+    struct LinkJob {
+        unsigned int programID = 0;
+        /// Empty if the program was loaded from the binary cache
+        std::vector<unsigned int> shaderIDs;
+        std::filesystem::path cacheFile;
+        std::string label;
+    };
+
+    struct PendingProgram {
+        std::shared_ptr<ShaderProgramHandle> handle;
+        uint64_t sourcesHash;
+        /// Vertex, fragment and optionally g-buffer fragment sources
+        std::vector<ShaderSource> sources;
+        LinkJob job;
+        /// Set once the main program is finished and its g-buffer variant is being linked
+        std::shared_ptr<ShaderProgram> program;
+    };
+
     std::vector<std::shared_ptr<ShaderProgram>> m_shaderPrograms;
 
+    /// Programs by hash of their sources
+    std::unordered_map<uint64_t, std::shared_ptr<ShaderProgram>> m_programsBySources;
+
+    std::vector<PendingProgram> m_pendingPrograms;
+
+    /// Handles by shader files and feature bitmask
+    std::unordered_map<std::string, std::shared_ptr<ShaderProgramHandle>> m_variants;
+
+    /// Vendor, renderer and version strings, part of binary cache keys. Empty if the driver has no binary formats
+    std::string m_driverVersion;
+    bool m_driverVersionQueried = false;
+
+    bool m_parallelCompile = false;
+    bool m_parallelCompileQueried = false;
+
+    unsigned int linkShaderProgram(
+        const std::vector<ShaderSource>& sources,
+        const std::string& label
+    );
+
+    /// Compiles and links without checking the status.
+    /// attribLocations are bound before linking, so both variants of a program can share VAOs
+    LinkJob submitLink(
+        const std::vector<ShaderSource>& sources,
+        const std::string& label,
+        const std::vector<std::pair<std::string, int>>& attribLocations = {}
+    );
+
+    /// Checks the status, waiting for the driver if needed. Returns the program id
+    unsigned int finishLink(const LinkJob& job);
+
+    /// Never waits with parallel compile support
+    bool isLinkComplete(const LinkJob& job);
+
+    /// Finishes the current link of program. Returns false if the g-buffer variant was submitted after it
+    bool advance(PendingProgram& pending);
+
+    /// Finishes handle's pending program, waiting for the driver
+    void finish(const ShaderProgramHandle& handle);
+
+    bool isParallelCompileSupported();
+
+    std::shared_ptr<ShaderProgram> addShaderProgram(unsigned int shaderProgramID, const std::string& label);
+
+    bool isCacheEnabled();
+
+    /// Returns 0 if there is no cached binary or the driver rejects it
+    static unsigned int loadProgramBinary(const std::filesystem::path& cacheFile);
+
+    static void saveProgramBinary(unsigned int shaderProgramID, const std::filesystem::path& cacheFile);
+
     static unsigned int createShader(
         const std::string& label,
-        const std::string& shaderPath,
-        GLenum shaderType
+        const ShaderSource& source
     );
 
+    static std::vector<std::pair<std::string, int>> attribLocations(const std::shared_ptr<ShaderProgram>& shaderProgram);
+
+    static ShaderSource readShaderSource(const std::filesystem::path& shaderFile, GLenum shaderType, unsigned int features = 0);
+
+    /// Resolves includes of the file recursively, skipping files in includedFiles
+    static std::string preprocess(const std::filesystem::path& filePath, std::unordered_set<std::string>& includedFiles);
+
+    static std::string featureDefines(unsigned int features);
+
     static std::string readShaderFile(const std::string& filePath);
 
     static void compileShader(
-        const std::string& label,
         const unsigned int& shaderID,
         const char* code
     );
+
+    /// Throws with the log of the first shader of job that failed to compile, then with the link log
+    [[noreturn]] static void throwLinkError(const LinkJob& job);
+
+    static uint64_t hashSources(const std::vector<ShaderSource>& sources, uint64_t seed = FNV_OFFSET_BASIS);
+
+    /// FNV-1a, stable between launches unlike std::hash
+    static uint64_t hash(const std::string& data, uint64_t seed = FNV_OFFSET_BASIS);
 };
 
 }
@@ -0,0 +1,587 @@
+#include "aabb_tree.h"
+
+#include <algorithm>
+#include <array>
+
+#include "frustum.h"
+#include "../../managers/engine.h"
+#include "../../managers/job_manager.h"
+
+namespace SimpleGL {
+
+AABBTree::AABBTree(float margin): m_margin(margin) {}
+
+AABBTree::~AABBTree() {
+    if (m_pendingBuild.valid()) {
+        m_pendingBuild.wait();
+    }
+}
+
+int AABBTree::insert(const AABB& aabb, int userData) {
+    int proxyId;
+
+    if (!m_freeProxies.empty()) {
+        proxyId = m_freeProxies.back();
+        m_freeProxies.pop_back();
+    }
+    else {
+        proxyId = static_cast<int>(m_proxies.size());
+        m_proxies.emplace_back();
+    }
+
+    const int leaf = allocateNode();
+
+    auto& proxy = m_proxies[proxyId];
+    proxy.fatAABB = aabb.expanded(m_margin);
+    proxy.userData = userData;
+    proxy.leaf = leaf;
+    proxy.alive = true;
+
+    m_nodes[leaf].aabb = proxy.fatAABB;
+    m_nodes[leaf].proxy = proxyId;
+
+    insertLeaf(leaf);
+    touch(proxyId);
+
+    m_proxiesCount += 1;
+
+    return proxyId;
+}
+
+void AABBTree::remove(int proxyId) {
+    auto& proxy = m_proxies[proxyId];
+
+    removeLeaf(proxy.leaf);
+    freeNode(proxy.leaf);
+
+    proxy.leaf = NULL_NODE;
+    proxy.alive = false;
+
+    touch(proxyId);
+
+    m_freeProxies.push_back(proxyId);
+    m_proxiesCount -= 1;
+}
+
+bool AABBTree::update(int proxyId, const AABB& aabb) {
+    auto& proxy = m_proxies[proxyId];
+
+    if (proxy.fatAABB.contains(aabb)) {
+        return false;
+    }
+
+    removeLeaf(proxy.leaf);
+
+    proxy.fatAABB = aabb.expanded(m_margin);
+    m_nodes[proxy.leaf].aabb = proxy.fatAABB;
+
+    insertLeaf(proxy.leaf);
+    touch(proxyId);
+
+    return true;
+}
+
+float AABBTree::cost() const {
+    if (m_root == NULL_NODE) {
+        return 0;
+    }
+
+    float internalArea = 0;
+
+    std::vector<int> stack;
+    stack.push_back(m_root);
+
+    while (!stack.empty()) {
+        const auto& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        if (node.isLeaf()) {
+            continue;
+        }
+
+        internalArea += node.aabb.surfaceArea();
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+
+    const float rootArea = m_nodes[m_root].aabb.surfaceArea();
+
+    return rootArea > 0 ? internalArea / rootArea : 0;
+}
+
+void AABBTree::rebuild() {
+    // a rebuild from the current state makes the pending one obsolete
+    if (m_pendingBuild.valid()) {
+        m_pendingBuild.wait();
+        m_pendingBuild = {};
+        m_pendingResult.reset();
+
+        for (const int proxyId : m_touchedProxies) {
+            m_proxies[proxyId].touched = false;
+        }
+
+        m_touchedProxies.clear();
+    }
+
+    auto input = createBuildInput();
+
+    BuildResult result;
+    build(input, static_cast<int>(m_proxies.size()), result);
+
+    applyBuildResult(result);
+}
+
+void AABBTree::rebuildAsync() {
+    if (isRebuilding()) {
+        return;
+    }
+
+    auto input = createBuildInput();
+    const auto proxiesCount = static_cast<int>(m_proxies.size());
+
+    m_pendingResult = std::make_shared<BuildResult>();
+
+    m_pendingBuild = Engine::get()->jobManager()->submit([input, proxiesCount, result = m_pendingResult]() mutable {
+        build(input, proxiesCount, *result);
+    });
+}
+
+bool AABBTree::applyRebuild() {
+    if (!isRebuilding() || m_pendingBuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return false;
+    }
+
+    m_pendingBuild.get();
+
+    applyBuildResult(*m_pendingResult);
+    m_pendingResult.reset();
+
+    return true;
+}
+
+void AABBTree::queryFrustum(const Frustum& frustum, std::vector<int>& inside, std::vector<int>& intersecting) const {
+    if (m_root == NULL_NODE) {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.push_back(m_root);
+
+    // leaves of subtrees lying completely inside the frustum are collected without further tests
+    const auto collectLeaves = [this, &inside](int subtreeRoot) {
+        std::vector<int> subtreeStack;
+        subtreeStack.push_back(subtreeRoot);
+
+        while (!subtreeStack.empty()) {
+            const auto& node = m_nodes[subtreeStack.back()];
+            subtreeStack.pop_back();
+
+            if (node.isLeaf()) {
+                inside.push_back(m_proxies[node.proxy].userData);
+            }
+            else {
+                subtreeStack.push_back(node.left);
+                subtreeStack.push_back(node.right);
+            }
+        }
+    };
+
+    while (!stack.empty()) {
+        const int index = stack.back();
+        const auto& node = m_nodes[index];
+        stack.pop_back();
+
+        const auto testResult = frustum.classify(node.aabb);
+
+        if (testResult == Outside) {
+            continue;
+        }
+
+        if (testResult == Inside) {
+            collectLeaves(index);
+        }
+        else if (node.isLeaf()) {
+            intersecting.push_back(m_proxies[node.proxy].userData);
+        }
+        else {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
+
+void AABBTree::querySphere(const BoundingSphere& sphere, const std::function<void(int userData)>& callback) const {
+    if (m_root == NULL_NODE) {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.push_back(m_root);
+
+    while (!stack.empty()) {
+        const auto& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        if (!node.aabb.intersects(sphere)) {
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            callback(m_proxies[node.proxy].userData);
+        }
+        else {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
+
+void AABBTree::queryRay(
+    const glm::vec3& origin,
+    const glm::vec3& direction,
+    float maxDistance,
+    const std::function<void(int userData)>& callback
+) const {
+    if (m_root == NULL_NODE) {
+        return;
+    }
+
+    const glm::vec3 inverseDirection = 1.f / direction;
+
+    // slab test
+    const auto isHit = [&](const AABB& aabb) {
+        const glm::vec3 t1 = (aabb.min - origin) * inverseDirection;
+        const glm::vec3 t2 = (aabb.max - origin) * inverseDirection;
+        const glm::vec3 tMin = glm::min(t1, t2);
+        const glm::vec3 tMax = glm::max(t1, t2);
+
+        const float enter = std::max({ tMin.x, tMin.y, tMin.z, 0.f });
+        const float exit = std::min({ tMax.x, tMax.y, tMax.z, maxDistance });
+
+        return enter <= exit;
+    };
+
+    std::vector<int> stack;
+    stack.push_back(m_root);
+
+    while (!stack.empty()) {
+        const auto& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        if (!isHit(node.aabb)) {
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            callback(m_proxies[node.proxy].userData);
+        }
+        else {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
+
+int AABBTree::allocateNode() {
+    if (m_freeNode == NULL_NODE) {
+        m_nodes.emplace_back();
+        return static_cast<int>(m_nodes.size()) - 1;
+    }
+
+    const int node = m_freeNode;
+    m_freeNode = m_nodes[node].proxy;
+    m_nodes[node] = TreeNode();
+
+    return node;
+}
+
+void AABBTree::freeNode(int node) {
+    m_nodes[node] = TreeNode();
+    m_nodes[node].proxy = m_freeNode;
+    m_freeNode = node;
+}
+
+// Catto, Erin. "Dynamic Bounding Volume Hierarchies", GDC 2019.
+// Descends to the sibling with the lowest surface area cost
+void AABBTree::insertLeaf(int leaf) {
+    if (m_root == NULL_NODE) {
+        m_root = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    const AABB leafAABB = m_nodes[leaf].aabb;
+    int index = m_root;
+
+    while (!m_nodes[index].isLeaf()) {
+        const auto& node = m_nodes[index];
+
+        const float area = node.aabb.surfaceArea();
+        const float combinedArea = node.aabb.merged(leafAABB).surfaceArea();
+
+        // cost of creating a new parent for this node and the leaf
+        const float cost = 2.f * combinedArea;
+        // minimum cost of pushing the leaf further down the tree
+        const float inheritanceCost = 2.f * (combinedArea - area);
+
+        const auto childCost = [&](int child) {
+            const auto& childAABB = m_nodes[child].aabb;
+            const float mergedArea = childAABB.merged(leafAABB).surfaceArea();
+
+            return m_nodes[child].isLeaf()
+                ? mergedArea + inheritanceCost
+                : mergedArea - childAABB.surfaceArea() + inheritanceCost;
+        };
+
+        const float leftCost = childCost(node.left);
+        const float rightCost = childCost(node.right);
+
+        if (cost < leftCost && cost < rightCost) {
+            break;
+        }
+
+        index = leftCost < rightCost ? node.left : node.right;
+    }
+
+    const int sibling = index;
+    const int oldParent = m_nodes[sibling].parent;
+    const int newParent = allocateNode();
+
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].aabb = m_nodes[sibling].aabb.merged(leafAABB);
+    m_nodes[newParent].left = sibling;
+    m_nodes[newParent].right = leaf;
+
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent == NULL_NODE) {
+        m_root = newParent;
+    }
+    else if (m_nodes[oldParent].left == sibling) {
+        m_nodes[oldParent].left = newParent;
+    }
+    else {
+        m_nodes[oldParent].right = newParent;
+    }
+
+    // refit ancestors
+    for (int i = m_nodes[leaf].parent; i != NULL_NODE; i = m_nodes[i].parent) {
+        m_nodes[i].aabb = m_nodes[m_nodes[i].left].aabb.merged(m_nodes[m_nodes[i].right].aabb);
+    }
+}
+
+void AABBTree::removeLeaf(int leaf) {
+    if (leaf == m_root) {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    const int parent = m_nodes[leaf].parent;
+    const int grandParent = m_nodes[parent].parent;
+    const int sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+    freeNode(parent);
+
+    if (grandParent == NULL_NODE) {
+        m_root = sibling;
+        m_nodes[sibling].parent = NULL_NODE;
+        return;
+    }
+
+    if (m_nodes[grandParent].left == parent) {
+        m_nodes[grandParent].left = sibling;
+    }
+    else {
+        m_nodes[grandParent].right = sibling;
+    }
+
+    m_nodes[sibling].parent = grandParent;
+
+    for (int i = grandParent; i != NULL_NODE; i = m_nodes[i].parent) {
+        m_nodes[i].aabb = m_nodes[m_nodes[i].left].aabb.merged(m_nodes[m_nodes[i].right].aabb);
+    }
+}
+
+void AABBTree::touch(int proxyId) {
+    auto& proxy = m_proxies[proxyId];
+
+    if (isRebuilding() && !proxy.touched) {
+        proxy.touched = true;
+        m_touchedProxies.push_back(proxyId);
+    }
+}
+
+std::vector<AABBTree::BuildInput> AABBTree::createBuildInput() const {
+    std::vector<BuildInput> input;
+    input.reserve(m_proxiesCount);
+
+    for (int i = 0; i < static_cast<int>(m_proxies.size()); i++) {
+        if (m_proxies[i].alive) {
+            input.push_back({ i, m_proxies[i].fatAABB });
+        }
+    }
+
+    return input;
+}
+
+void AABBTree::applyBuildResult(BuildResult& result) {
+    m_nodes = std::move(result.nodes);
+    m_root = result.root;
+    m_freeNode = NULL_NODE;
+
+    const auto snapshotLeaf = [&result](int proxyId) {
+        return proxyId < static_cast<int>(result.proxyLeaves.size()) ? result.proxyLeaves[proxyId] : NULL_NODE;
+    };
+
+    for (int i = 0; i < static_cast<int>(m_proxies.size()); i++) {
+        if (!m_proxies[i].touched) {
+            m_proxies[i].leaf = snapshotLeaf(i);
+        }
+    }
+
+    // replay changes made while the tree was being built
+    for (const int proxyId : m_touchedProxies) {
+        auto& proxy = m_proxies[proxyId];
+        const int leaf = snapshotLeaf(proxyId);
+
+        if (leaf != NULL_NODE) {
+            removeLeaf(leaf);
+            freeNode(leaf);
+        }
+
+        proxy.touched = false;
+        proxy.leaf = NULL_NODE;
+
+        if (proxy.alive) {
+            proxy.leaf = allocateNode();
+            m_nodes[proxy.leaf].aabb = proxy.fatAABB;
+            m_nodes[proxy.leaf].proxy = proxyId;
+
+            insertLeaf(proxy.leaf);
+        }
+    }
+
+    m_touchedProxies.clear();
+}
+
+void AABBTree::build(std::vector<BuildInput>& input, int proxiesCount, BuildResult& result) {
+    result.proxyLeaves.assign(proxiesCount, NULL_NODE);
+    result.nodes.reserve(std::max<size_t>(input.size() * 2, 1) - 1);
+
+    if (!input.empty()) {
+        result.root = buildRange(input, 0, static_cast<int>(input.size()), NULL_NODE, result);
+    }
+}
+
+// Wald, Ingo. "On fast Construction of SAH-based Bounding Volume Hierarchies", 2007.
+int AABBTree::buildRange(std::vector<BuildInput>& input, int begin, int end, int parent, BuildResult& result) {
+    const int nodeIndex = static_cast<int>(result.nodes.size());
+
+    result.nodes.emplace_back();
+    result.nodes[nodeIndex].parent = parent;
+
+    if (end - begin == 1) {
+        result.nodes[nodeIndex].aabb = input[begin].aabb;
+        result.nodes[nodeIndex].proxy = input[begin].proxy;
+        result.proxyLeaves[input[begin].proxy] = nodeIndex;
+
+        return nodeIndex;
+    }
+
+    AABB centroidBounds = { input[begin].aabb.center(), input[begin].aabb.center() };
+
+    for (int i = begin + 1; i < end; i++) {
+        const glm::vec3 centroid = input[i].aabb.center();
+        centroidBounds = { glm::min(centroidBounds.min, centroid), glm::max(centroidBounds.max, centroid) };
+    }
+
+    const glm::vec3 centroidSize = centroidBounds.max - centroidBounds.min;
+    const int axis = centroidSize.x > centroidSize.y
+        ? (centroidSize.x > centroidSize.z ? 0 : 2)
+        : (centroidSize.y > centroidSize.z ? 1 : 2);
+
+    int middle = begin;
+
+    if (centroidSize[axis] > 1e-6f) {
+        constexpr int binsCount = 12;
+
+        struct Bin {
+            AABB aabb;
+            int count = 0;
+        };
+
+        std::array<Bin, binsCount> bins{};
+
+        const auto getBin = [&](const BuildInput& item) {
+            const float offset = (item.aabb.center()[axis] - centroidBounds.min[axis]) / centroidSize[axis];
+            return std::min(static_cast<int>(offset * binsCount), binsCount - 1);
+        };
+
+        for (int i = begin; i < end; i++) {
+            auto& bin = bins[getBin(input[i])];
+
+            bin.aabb = bin.count == 0 ? input[i].aabb : bin.aabb.merged(input[i].aabb);
+            bin.count += 1;
+        }
+
+        // cost of splitting after each bin, accumulated from both sides
+        std::array<float, binsCount - 1> splitCosts{};
+
+        AABB accumulated;
+        int accumulatedCount = 0;
+
+        for (int i = 0; i < binsCount - 1; i++) {
+            if (bins[i].count > 0) {
+                accumulated = accumulatedCount == 0 ? bins[i].aabb : accumulated.merged(bins[i].aabb);
+                accumulatedCount += bins[i].count;
+            }
+
+            splitCosts[i] = accumulatedCount > 0 ? accumulated.surfaceArea() * accumulatedCount : 0;
+        }
+
+        accumulatedCount = 0;
+
+        for (int i = binsCount - 1; i > 0; i--) {
+            if (bins[i].count > 0) {
+                accumulated = accumulatedCount == 0 ? bins[i].aabb : accumulated.merged(bins[i].aabb);
+                accumulatedCount += bins[i].count;
+            }
+
+            splitCosts[i - 1] += accumulatedCount > 0 ? accumulated.surfaceArea() * accumulatedCount : 0;
+        }
+
+        const int bestSplit = static_cast<int>(std::min_element(splitCosts.begin(), splitCosts.end()) - splitCosts.begin());
+
+        middle = static_cast<int>(std::partition(
+            input.begin() + begin,
+            input.begin() + end,
+            [&](const BuildInput& item) { return getBin(item) <= bestSplit; }
+        ) - input.begin());
+    }
+
+    // all centroids fell into one side
+    if (middle == begin || middle == end) {
+        middle = (begin + end) / 2;
+
+        std::nth_element(
+            input.begin() + begin,
+            input.begin() + middle,
+            input.begin() + end,
+            [axis](const BuildInput& a, const BuildInput& b) { return a.aabb.center()[axis] < b.aabb.center()[axis]; }
+        );
+    }
+
+    const int left = buildRange(input, begin, middle, nodeIndex, result);
+    const int right = buildRange(input, middle, end, nodeIndex, result);
+
+    auto& node = result.nodes[nodeIndex];
+    node.left = left;
+    node.right = right;
+    node.aabb = result.nodes[left].aabb.merged(result.nodes[right].aabb);
+
+    return nodeIndex;
+}
+
+}
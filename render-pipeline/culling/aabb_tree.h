@@ -0,0 +1,127 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "bounds.h"
+
+namespace SimpleGL {
+
+class Frustum;
+
+/// Dynamic bounding volume hierarchy.
+/// Leaves store fat AABBs, so the tree changes only when a box leaves its fat AABB.
+/// Incremental insertion degrades the tree over time, rebuildAsync builds a new binned SAH tree
+/// on a worker thread from a snapshot of proxies, changes made meanwhile are replayed by applyRebuild.
+class AABBTree {
+public:
+    static constexpr int NULL_NODE = -1;
+
+    /// margin is added to each side of inserted boxes
+    explicit AABBTree(float margin);
+    ~AABBTree();
+
+    /// Returns proxy id, which stays the same until the proxy is removed
+    int insert(const AABB& aabb, int userData);
+    void remove(int proxyId);
+
+    /// Returns true if the box left its fat AABB and the proxy was reinserted
+    bool update(int proxyId, const AABB& aabb);
+
+    int userData(int proxyId) const { return m_proxies[proxyId].userData; }
+    void setUserData(int proxyId, int userData) { m_proxies[proxyId].userData = userData; }
+
+    const AABB& fatAABB(int proxyId) const { return m_proxies[proxyId].fatAABB; }
+
+    int proxiesCount() const { return m_proxiesCount; }
+
+    /// Surface area heuristic cost of the tree relative to the root box. Lower is better
+    float cost() const;
+
+    /// Synchronously replaces the tree with a binned SAH one
+    void rebuild();
+
+    void rebuildAsync();
+    bool isRebuilding() const { return m_pendingBuild.valid(); }
+
+    /// Swaps in the tree built by rebuildAsync if it is ready. Returns true if the tree was replaced
+    bool applyRebuild();
+
+    /// Splits user data of leaves touching the frustum into ones lying completely inside
+    /// and ones which only intersect it, the latter need a finer test
+    void queryFrustum(const Frustum& frustum, std::vector<int>& inside, std::vector<int>& intersecting) const;
+
+    void querySphere(const BoundingSphere& sphere, const std::function<void(int userData)>& callback) const;
+
+    /// Calls callback for leaves whose fat AABB is hit by the ray within maxDistance
+    void queryRay(
+        const glm::vec3& origin,
+        const glm::vec3& direction,
+        float maxDistance,
+        const std::function<void(int userData)>& callback
+    ) const;
+
+private:
+    struct TreeNode {
+        AABB aabb;
+        int parent = NULL_NODE;
+        int left = NULL_NODE;
+        int right = NULL_NODE;
+        /// Proxy of a leaf. Free nodes keep index of the next free node here
+        int proxy = NULL_NODE;
+
+        bool isLeaf() const { return left == NULL_NODE; }
+    };
+
+    struct Proxy {
+        AABB fatAABB;
+        int userData = 0;
+        int leaf = NULL_NODE;
+        bool alive = false;
+        /// Changed after the snapshot of the pending rebuild was taken
+        bool touched = false;
+    };
+
+    struct BuildInput {
+        int proxy;
+        AABB aabb;
+    };
+
+    struct BuildResult {
+        std::vector<TreeNode> nodes;
+        std::vector<int> proxyLeaves;
+        int root = NULL_NODE;
+    };
+
+    const float m_margin;
+
+    std::vector<TreeNode> m_nodes;
+    int m_root = NULL_NODE;
+    int m_freeNode = NULL_NODE;
+
+    std::vector<Proxy> m_proxies;
+    std::vector<int> m_freeProxies;
+    int m_proxiesCount = 0;
+
+    std::future<void> m_pendingBuild;
+    std::shared_ptr<BuildResult> m_pendingResult;
+    std::vector<int> m_touchedProxies;
+
+    int allocateNode();
+    void freeNode(int node);
+
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+
+    void touch(int proxyId);
+
+    std::vector<BuildInput> createBuildInput() const;
+    void applyBuildResult(BuildResult& result);
+
+    static void build(std::vector<BuildInput>& input, int proxiesCount, BuildResult& result);
+    static int buildRange(std::vector<BuildInput>& input, int begin, int end, int parent, BuildResult& result);
+};
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+namespace SimpleGL {
+
+struct BoundingSphere;
+
+struct AABB {
+    glm::vec3 min = glm::vec3(0);
+    glm::vec3 max = glm::vec3(0);
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+    float surfaceArea() const {
+        const glm::vec3 size = max - min;
+        return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    bool contains(const AABB& other) const {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+
+    bool intersects(const AABB& other) const {
+        return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+    }
+
+    bool intersects(const BoundingSphere& sphere) const;
+
+    AABB merged(const AABB& other) const { return { glm::min(min, other.min), glm::max(max, other.max) }; }
+
+    AABB expanded(float margin) const { return { min - glm::vec3(margin), max + glm::vec3(margin) }; }
+
+    /// Bounds of the box transformed by matrix (Arvo, "Transforming Axis-Aligned Bounding Boxes")
+    AABB transformed(const glm::mat4& matrix) const {
+        const glm::vec3 worldCenter = glm::vec3(matrix * glm::vec4(center(), 1.f));
+        const glm::mat3 absMatrix = glm::mat3(
+            glm::abs(glm::vec3(matrix[0])),
+            glm::abs(glm::vec3(matrix[1])),
+            glm::abs(glm::vec3(matrix[2]))
+        );
+        const glm::vec3 worldExtents = absMatrix * extents();
+
+        return { worldCenter - worldExtents, worldCenter + worldExtents };
+    }
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0);
+    float radius = 0;
+
+    BoundingSphere transformed(const glm::mat4& matrix) const {
+        const float maxScale = std::max({
+            glm::length(glm::vec3(matrix[0])),
+            glm::length(glm::vec3(matrix[1])),
+            glm::length(glm::vec3(matrix[2]))
+        });
+
+        return { glm::vec3(matrix * glm::vec4(center, 1.f)), radius * maxScale };
+    }
+};
+
+inline bool AABB::intersects(const BoundingSphere& sphere) const {
+    const glm::vec3 offset = glm::clamp(sphere.center, min, max) - sphere.center;
+    return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+}
+
+}
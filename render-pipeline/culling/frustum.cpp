@@ -0,0 +1,70 @@
+#include "frustum.h"
+
+namespace SimpleGL {
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    const glm::mat4 m = glm::transpose(viewProjection);
+
+    m_planes[0] = m[3] + m[0]; // left
+    m_planes[1] = m[3] - m[0]; // right
+    m_planes[2] = m[3] + m[1]; // bottom
+    m_planes[3] = m[3] - m[1]; // top
+    m_planes[4] = m[3] + m[2]; // near
+    m_planes[5] = m[3] - m[2]; // far
+
+    for (auto& plane : m_planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::intersects(const AABB& aabb) const {
+    const glm::vec3 center = aabb.center();
+    const glm::vec3 extents = aabb.extents();
+
+    for (const auto& plane : m_planes) {
+        const glm::vec3 normal = glm::vec3(plane);
+        const float distance = glm::dot(normal, center) + plane.w;
+        const float radius = glm::dot(glm::abs(normal), extents);
+
+        if (distance + radius < 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const {
+    for (const auto& plane : m_planes) {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+FrustumTestResult Frustum::classify(const AABB& aabb) const {
+    const glm::vec3 center = aabb.center();
+    const glm::vec3 extents = aabb.extents();
+
+    FrustumTestResult result = Inside;
+
+    for (const auto& plane : m_planes) {
+        const glm::vec3 normal = glm::vec3(plane);
+        const float distance = glm::dot(normal, center) + plane.w;
+        const float radius = glm::dot(glm::abs(normal), extents);
+
+        if (distance + radius < 0) {
+            return Outside;
+        }
+
+        if (distance - radius < 0) {
+            result = Intersects;
+        }
+    }
+
+    return result;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+namespace SimpleGL {
+
+enum FrustumTestResult {
+    Outside,
+    Intersects,
+    Inside
+};
+
+/// Six planes of a view frustum in world space. Plane normals point inside, plane is (normal, distance)
+class Frustum {
+public:
+    Frustum() = default;
+
+    /// Gribb & Hartmann, "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix"
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    const std::array<glm::vec4, 6>& planes() const { return m_planes; }
+
+    bool intersects(const AABB& aabb) const;
+    bool intersects(const BoundingSphere& sphere) const;
+
+    /// Unlike intersects, tells apart boxes lying completely inside the frustum
+    FrustumTestResult classify(const AABB& aabb) const;
+
+private:
+    std::array<glm::vec4, 6> m_planes{};
+};
+
+}
@@ -0,0 +1,373 @@
+#include "occlusion_culler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../../managers/engine.h"
+#include "../../managers/job_manager.h"
+#include "../../entities/mesh_data.h"
+#include "../../entities/node.h"
+#include "../../entities/components/camera.h"
+#include "../../entities/components/mesh.h"
+#include "../../entities/components/transform.h"
+#include "../../window/window.h"
+#include "../../window/input.h"
+
+namespace SimpleGL {
+
+void OcclusionCuller::addOccluder(const std::shared_ptr<MeshComponent>& mesh) {
+    addOccluder(mesh, boxVertices(mesh->meshData()->aabb()), boxIndices());
+}
+
+void OcclusionCuller::addOccluder(
+    const std::shared_ptr<MeshComponent>& mesh,
+    const std::vector<glm::vec3>& vertices,
+    const std::vector<unsigned int>& indices
+) {
+    m_occluders.push_back({ mesh, vertices, indices });
+    m_renderFrameIndex = -1;
+}
+
+void OcclusionCuller::removeOccluder(const std::shared_ptr<MeshComponent>& mesh) {
+    std::erase_if(m_occluders, [&mesh](const Occluder& occluder) { return occluder.mesh == mesh; });
+    m_renderFrameIndex = -1;
+}
+
+void OcclusionCuller::render(const std::shared_ptr<Camera>& camera) {
+    const uint64_t frameIndex = Engine::get()->window()->input()->frameIndex();
+
+    const bool isRendered = frameIndex == m_renderFrameIndex
+        && camera->viewMatrix() == m_renderViewMatrix
+        && camera->projectionMatrix() == m_renderProjectionMatrix;
+
+    if (isRendered) {
+        return;
+    }
+
+    m_renderFrameIndex = frameIndex;
+    m_renderViewMatrix = camera->viewMatrix();
+    m_renderProjectionMatrix = camera->projectionMatrix();
+    m_viewProjection = m_renderProjectionMatrix * m_renderViewMatrix;
+
+    setupTriangles();
+    binTriangles();
+
+    if (m_hierarchicalDepth.empty()) {
+        m_hierarchicalDepth.emplace_back(WIDTH * HEIGHT);
+        m_levelSizes.emplace_back(WIDTH, HEIGHT);
+    }
+
+    Engine::get()->jobManager()->parallelFor(TILES_X * TILES_Y, 1, [this](unsigned int begin, unsigned int end) {
+        for (unsigned int tileIndex = begin; tileIndex < end; tileIndex++) {
+            rasterizeTile(static_cast<int>(tileIndex));
+        }
+    });
+
+    buildHierarchicalDepth();
+}
+
+bool OcclusionCuller::isVisible(const AABB& aabb) const {
+    if (m_hierarchicalDepth.empty()) {
+        return true;
+    }
+
+    glm::vec2 screenMin = glm::vec2(1);
+    glm::vec2 screenMax = glm::vec2(-1);
+    float minDepth = 1;
+
+    for (int i = 0; i < 8; i++) {
+        const glm::vec3 corner = glm::vec3(
+            i & 1 ? aabb.max.x : aabb.min.x,
+            i & 2 ? aabb.max.y : aabb.min.y,
+            i & 4 ? aabb.max.z : aabb.min.z
+        );
+
+        const glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.f);
+
+        // the box crosses the near plane, its projection is unbounded
+        if (clip.w < 1e-5f || clip.z < -clip.w) {
+            return true;
+        }
+
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+
+        screenMin = glm::min(screenMin, glm::vec2(ndc.x, ndc.y));
+        screenMax = glm::max(screenMax, glm::vec2(ndc.x, ndc.y));
+        minDepth = std::min(minDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    if (screenMax.x < -1 || screenMin.x > 1 || screenMax.y < -1 || screenMin.y > 1) {
+        return false;
+    }
+
+    const auto toPixel = [](float ndc, int size) {
+        return std::clamp(static_cast<int>((ndc * 0.5f + 0.5f) * size), 0, size - 1);
+    };
+
+    const int x0 = toPixel(screenMin.x, WIDTH);
+    const int x1 = toPixel(screenMax.x, WIDTH);
+    const int y0 = toPixel(screenMin.y, HEIGHT);
+    const int y1 = toPixel(screenMax.y, HEIGHT);
+
+    // the level where the rectangle covers at most 2x2 texels
+    const int size = std::max(x1 - x0, y1 - y0) + 1;
+    const int lastLevel = static_cast<int>(m_hierarchicalDepth.size()) - 1;
+    const int level = std::clamp(static_cast<int>(std::ceil(std::log2(static_cast<float>(size)))) - 1, 0, lastLevel);
+
+    const auto& depth = m_hierarchicalDepth[level];
+    const int levelWidth = m_levelSizes[level].x;
+
+    float maxDepth = 0;
+
+    for (int y = y0 >> level; y <= y1 >> level; y++) {
+        for (int x = x0 >> level; x <= x1 >> level; x++) {
+            maxDepth = std::max(maxDepth, depth[y * levelWidth + x]);
+        }
+    }
+
+    return minDepth <= maxDepth;
+}
+
+void OcclusionCuller::setupTriangles() {
+    m_triangles.clear();
+
+    for (const auto& occluder : m_occluders) {
+        if (occluder.mesh->node()->visible == false) {
+            continue;
+        }
+
+        const glm::mat4 transform = m_viewProjection * occluder.mesh->transform()->transformMatrix();
+
+        std::vector<glm::vec4> clipVertices;
+        clipVertices.reserve(occluder.vertices.size());
+
+        for (const auto& vertex : occluder.vertices) {
+            clipVertices.push_back(transform * glm::vec4(vertex, 1.f));
+        }
+
+        for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3) {
+            clipAndAddTriangle(
+                clipVertices[occluder.indices[i]],
+                clipVertices[occluder.indices[i + 1]],
+                clipVertices[occluder.indices[i + 2]]
+            );
+        }
+    }
+}
+
+// Clips the triangle by near plane (z >= -w) and by w >= epsilon, which matters for oblique projections of portal cameras.
+// Sides of the frustum are handled by clamping to the screen during rasterization
+void OcclusionCuller::clipAndAddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+    constexpr float minW = 1e-5f;
+
+    std::vector<glm::vec4> polygon = { a, b, c };
+    std::vector<glm::vec4> clipped;
+
+    const auto clip = [&](const auto& distance) {
+        clipped.clear();
+
+        for (size_t i = 0; i < polygon.size(); i++) {
+            const glm::vec4& current = polygon[i];
+            const glm::vec4& next = polygon[(i + 1) % polygon.size()];
+
+            const float currentDistance = distance(current);
+            const float nextDistance = distance(next);
+
+            if (currentDistance >= 0) {
+                clipped.push_back(current);
+            }
+
+            if ((currentDistance >= 0) != (nextDistance >= 0)) {
+                const float t = currentDistance / (currentDistance - nextDistance);
+                clipped.push_back(current + (next - current) * t);
+            }
+        }
+
+        std::swap(polygon, clipped);
+    };
+
+    clip([](const glm::vec4& v) { return v.z + v.w; });
+    clip([](const glm::vec4& v) { return v.w - minW; });
+
+    if (polygon.size() < 3) {
+        return;
+    }
+
+    const auto toScreen = [](const glm::vec4& v) {
+        const glm::vec3 ndc = glm::vec3(v) / v.w;
+
+        return glm::vec3(
+            (ndc.x * 0.5f + 0.5f) * WIDTH,
+            (ndc.y * 0.5f + 0.5f) * HEIGHT,
+            ndc.z * 0.5f + 0.5f
+        );
+    };
+
+    const glm::vec3 first = toScreen(polygon[0]);
+
+    for (size_t i = 1; i + 1 < polygon.size(); i++) {
+        m_triangles.push_back({ first, toScreen(polygon[i]), toScreen(polygon[i + 1]) });
+    }
+}
+
+void OcclusionCuller::binTriangles() {
+    for (auto& bin : m_tileBins) {
+        bin.clear();
+    }
+
+    for (unsigned int i = 0; i < m_triangles.size(); i++) {
+        const auto& triangle = m_triangles[i];
+
+        const float minX = std::min({ triangle.v0.x, triangle.v1.x, triangle.v2.x });
+        const float maxX = std::max({ triangle.v0.x, triangle.v1.x, triangle.v2.x });
+        const float minY = std::min({ triangle.v0.y, triangle.v1.y, triangle.v2.y });
+        const float maxY = std::max({ triangle.v0.y, triangle.v1.y, triangle.v2.y });
+
+        if (maxX < 0 || minX >= WIDTH || maxY < 0 || minY >= HEIGHT) {
+            continue;
+        }
+
+        const int tileX0 = std::clamp(static_cast<int>(minX) / TILE_SIZE, 0, TILES_X - 1);
+        const int tileX1 = std::clamp(static_cast<int>(maxX) / TILE_SIZE, 0, TILES_X - 1);
+        const int tileY0 = std::clamp(static_cast<int>(minY) / TILE_SIZE, 0, TILES_Y - 1);
+        const int tileY1 = std::clamp(static_cast<int>(maxY) / TILE_SIZE, 0, TILES_Y - 1);
+
+        for (int tileY = tileY0; tileY <= tileY1; tileY++) {
+            for (int tileX = tileX0; tileX <= tileX1; tileX++) {
+                m_tileBins[tileY * TILES_X + tileX].push_back(i);
+            }
+        }
+    }
+}
+
+// Pineda, Juan. "A Parallel Algorithm for Polygon Rasterization", 1988.
+// Each job owns whole tiles, so depth writes never overlap between threads
+void OcclusionCuller::rasterizeTile(int tileIndex) {
+    auto& depth = m_hierarchicalDepth[0];
+
+    const int tileX = (tileIndex % TILES_X) * TILE_SIZE;
+    const int tileY = (tileIndex / TILES_X) * TILE_SIZE;
+
+    for (int y = tileY; y < tileY + TILE_SIZE; y++) {
+        std::fill_n(depth.begin() + y * WIDTH + tileX, TILE_SIZE, 1.f);
+    }
+
+    for (const unsigned int triangleIndex : m_tileBins[tileIndex]) {
+        const auto& [v0, v1, v2] = m_triangles[triangleIndex];
+
+        const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+
+        if (std::abs(area) < 1e-6f) {
+            continue;
+        }
+
+        // both windings are rasterized, edge functions are flipped to be positive inside
+        const float sign = area > 0 ? 1.f : -1.f;
+        const float inverseArea = 1.f / std::abs(area);
+
+        // edge function w(x, y) = A * x + B * y + C, opposite to the vertex with the same index
+        const float a0 = (v1.y - v2.y) * sign, b0 = (v2.x - v1.x) * sign, c0 = (v1.x * v2.y - v1.y * v2.x) * sign;
+        const float a1 = (v2.y - v0.y) * sign, b1 = (v0.x - v2.x) * sign, c1 = (v2.x * v0.y - v2.y * v0.x) * sign;
+        const float a2 = (v0.y - v1.y) * sign, b2 = (v1.x - v0.x) * sign, c2 = (v0.x * v1.y - v0.y * v1.x) * sign;
+
+        const float dz1 = (v1.z - v0.z) * inverseArea;
+        const float dz2 = (v2.z - v0.z) * inverseArea;
+
+        const int x0 = std::max(tileX, static_cast<int>(std::min({ v0.x, v1.x, v2.x })));
+        const int x1 = std::min(tileX + TILE_SIZE - 1, static_cast<int>(std::max({ v0.x, v1.x, v2.x })));
+        const int y0 = std::max(tileY, static_cast<int>(std::min({ v0.y, v1.y, v2.y })));
+        const int y1 = std::min(tileY + TILE_SIZE - 1, static_cast<int>(std::max({ v0.y, v1.y, v2.y })));
+
+        for (int y = y0; y <= y1; y++) {
+            const float py = static_cast<float>(y) + 0.5f;
+
+            const float row0 = b0 * py + c0;
+            const float row1 = b1 * py + c1;
+            const float row2 = b2 * py + c2;
+
+            float* depthRow = depth.data() + y * WIDTH;
+
+            // no dependencies between iterations, so the compiler vectorizes the row
+            for (int x = x0; x <= x1; x++) {
+                const float px = static_cast<float>(x) + 0.5f;
+
+                const float w0 = a0 * px + row0;
+                const float w1 = a1 * px + row1;
+                const float w2 = a2 * px + row2;
+
+                const bool isInside = w0 >= 0 && w1 >= 0 && w2 >= 0;
+                const float z = v0.z + w1 * dz1 + w2 * dz2;
+
+                depthRow[x] = isInside ? std::min(depthRow[x], z) : depthRow[x];
+            }
+        }
+    }
+}
+
+void OcclusionCuller::buildHierarchicalDepth() {
+    if (m_hierarchicalDepth.size() == 1) {
+        glm::ivec2 size = m_levelSizes[0];
+
+        while (size.x > 1 || size.y > 1) {
+            size = glm::ivec2(std::max(1, (size.x + 1) / 2), std::max(1, (size.y + 1) / 2));
+
+            m_levelSizes.push_back(size);
+            m_hierarchicalDepth.emplace_back(size.x * size.y);
+        }
+    }
+
+    for (size_t level = 1; level < m_hierarchicalDepth.size(); level++) {
+        const auto& previous = m_hierarchicalDepth[level - 1];
+        const glm::ivec2 previousSize = m_levelSizes[level - 1];
+
+        auto& current = m_hierarchicalDepth[level];
+        const glm::ivec2 size = m_levelSizes[level];
+
+        for (int y = 0; y < size.y; y++) {
+            const int y0 = y * 2;
+            const int y1 = std::min(y0 + 1, previousSize.y - 1);
+
+            for (int x = 0; x < size.x; x++) {
+                const int x0 = x * 2;
+                const int x1 = std::min(x0 + 1, previousSize.x - 1);
+
+                current[y * size.x + x] = std::max({
+                    previous[y0 * previousSize.x + x0],
+                    previous[y0 * previousSize.x + x1],
+                    previous[y1 * previousSize.x + x0],
+                    previous[y1 * previousSize.x + x1]
+                });
+            }
+        }
+    }
+}
+
+std::vector<glm::vec3> OcclusionCuller::boxVertices(const AABB& aabb) {
+    std::vector<glm::vec3> vertices;
+
+    for (int i = 0; i < 8; i++) {
+        vertices.emplace_back(
+            i & 1 ? aabb.max.x : aabb.min.x,
+            i & 2 ? aabb.max.y : aabb.min.y,
+            i & 4 ? aabb.max.z : aabb.min.z
+        );
+    }
+
+    return vertices;
+}
+
+const std::vector<unsigned int>& OcclusionCuller::boxIndices() {
+    // corners are indexed by bits: 1 - x, 2 - y, 4 - z
+    static const std::vector<unsigned int> indices = {
+        0, 2, 3,  0, 3, 1, // -z
+        4, 5, 7,  4, 7, 6, // +z
+        0, 4, 6,  0, 6, 2, // -x
+        1, 3, 7,  1, 7, 5, // +x
+        0, 1, 5,  0, 5, 4, // -y
+        2, 6, 7,  2, 7, 3  // +y
+    };
+
+    return indices;
+}
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+namespace SimpleGL {
+
+class Camera;
+class MeshComponent;
+
+/// Software occlusion culling.
+/// Occluders are rasterized on the CPU into a low resolution depth buffer, split into tiles processed by job threads.
+/// Occludees are tested against a hierarchical max-depth pyramid built from that buffer.
+/// Does not use OpenGL, so it also works without a window context.
+class OcclusionCuller {
+public:
+    static constexpr int WIDTH = 256;
+    static constexpr int HEIGHT = 192;
+    static constexpr int TILE_SIZE = 32;
+    static constexpr int TILES_X = WIDTH / TILE_SIZE;
+    static constexpr int TILES_Y = HEIGHT / TILE_SIZE;
+
+    /// Mesh's local AABB is used as the occluder shape, so it must be a good fit for box-like meshes only
+    void addOccluder(const std::shared_ptr<MeshComponent>& mesh);
+
+    /// Simplified occluder shape in mesh local space. It must lie inside the mesh, otherwise visible meshes get culled
+    void addOccluder(
+        const std::shared_ptr<MeshComponent>& mesh,
+        const std::vector<glm::vec3>& vertices,
+        const std::vector<unsigned int>& indices
+    );
+
+    void removeOccluder(const std::shared_ptr<MeshComponent>& mesh);
+
+    /// Rasterizes occluders as seen by camera. Does nothing if the camera's view was already rendered this frame
+    void render(const std::shared_ptr<Camera>& camera);
+
+    /// Uses the view passed to the last render call
+    bool isVisible(const AABB& aabb) const;
+
+    /// Depth in [0, 1], row by row from the bottom of the screen
+    const std::vector<float>& depthBuffer() const { return m_hierarchicalDepth[0]; }
+
+private:
+    struct Occluder {
+        std::shared_ptr<MeshComponent> mesh;
+        std::vector<glm::vec3> vertices;
+        std::vector<unsigned int> indices;
+    };
+
+    /// Triangle in screen space: x, y in pixels, z is depth in [0, 1]
+    struct ScreenTriangle {
+        glm::vec3 v0;
+        glm::vec3 v1;
+        glm::vec3 v2;
+    };
+
+    std::vector<Occluder> m_occluders;
+
+    glm::mat4 m_viewProjection = glm::mat4(1);
+
+    uint64_t m_renderFrameIndex = -1;
+    glm::mat4 m_renderViewMatrix = glm::mat4(0);
+    glm::mat4 m_renderProjectionMatrix = glm::mat4(0);
+
+    std::vector<ScreenTriangle> m_triangles;
+    std::vector<std::vector<unsigned int>> m_tileBins = std::vector<std::vector<unsigned int>>(TILES_X * TILES_Y);
+
+    /// Level 0 is the depth buffer, every next level keeps the max depth of 2x2 texels of the previous one
+    std::vector<std::vector<float>> m_hierarchicalDepth;
+    std::vector<glm::ivec2> m_levelSizes;
+
+    void setupTriangles();
+    void clipAndAddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+    void binTriangles();
+
+    void rasterizeTile(int tileIndex);
+
+    void buildHierarchicalDepth();
+
+    static std::vector<glm::vec3> boxVertices(const AABB& aabb);
+    static const std::vector<unsigned int>& boxIndices();
+};
+
+}
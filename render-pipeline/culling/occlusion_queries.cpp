@@ -0,0 +1,224 @@
+#include "occlusion_queries.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "frustum.h"
+#include "../geometry/vertex_format.h"
+#include "../state/gl_state_cache.h"
+#include "../../managers/engine.h"
+#include "../../managers/shader_manager.h"
+#include "../../entities/shader_program.h"
+#include "../../entities/components/camera.h"
+#include "../../entities/components/mesh.h"
+#include "../../window/window.h"
+#include "../../window/input.h"
+
+namespace SimpleGL {
+
+OcclusionQueries::OcclusionQueries() {
+    m_shader = Engine::get()->shaderManager()->createShaderProgram(
+        "shaders/depth-only/vertex.glsl",
+        "shaders/depth-only/fragment.glsl",
+        "depth only shader program"
+    );
+
+    createBox();
+}
+
+OcclusionQueries::~OcclusionQueries() {
+    for (const auto& [key, query] : m_queries) {
+        glDeleteQueries(1, &query.id);
+    }
+
+    glDeleteVertexArrays(1, &m_boxVAO);
+    glDeleteBuffers(1, &m_boxVBO);
+    glDeleteBuffers(1, &m_boxEBO);
+}
+
+void OcclusionQueries::update() {
+    const uint64_t frameIndex = Engine::get()->window()->input()->frameIndex();
+
+    for (auto it = m_queries.begin(); it != m_queries.end();) {
+        auto& query = it->second;
+
+        if (query.pending) {
+            unsigned int available = GL_FALSE;
+            glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (available == GL_TRUE) {
+                unsigned int anySamplesPassed = GL_FALSE;
+                glGetQueryObjectuiv(query.id, GL_QUERY_RESULT, &anySamplesPassed);
+
+                query.pending = false;
+
+                // result of a skipped key is outdated
+                if (query.valid) {
+                    query.visible = anySamplesPassed == GL_TRUE;
+                }
+            }
+        }
+
+        if (!query.pending && frameIndex - query.usedFrameIndex > MAX_UNUSED_FRAMES) {
+            glDeleteQueries(1, &query.id);
+            it = m_queries.erase(it);
+            continue;
+        }
+
+        ++it;
+    }
+}
+
+void OcclusionQueries::query(const std::vector<std::pair<const void*, AABB>>& boxes, const std::shared_ptr<Camera>& camera) {
+    const uint64_t frameIndex = Engine::get()->window()->input()->frameIndex();
+    const Frustum frustum(camera->projectionMatrix() * camera->viewMatrix());
+    const glm::vec3& cameraPosition = camera->position();
+
+    // faces behind the occluders count as well, so the box is visible if any part of it is
+    static constexpr PipelineState queryState = [] {
+        PipelineState state = PipelineState::opaque();
+        state.depthWrite = false;
+        state.depthFunc = GL_LEQUAL;
+        state.cullFace = false;
+        state.colorWrite = false;
+        return state;
+    }();
+
+    const auto& glState = Engine::get()->glState();
+
+    glState->apply(queryState);
+
+    m_shader->use(camera);
+    glBindVertexArray(m_boxVAO);
+
+    // box vertices are floats, while meshes drawn with the same program may be quantized
+    m_shader->setUniform("positionOffset", glm::vec3(0));
+    m_shader->setUniform("positionScale", glm::vec3(1));
+
+    for (const auto& [key, aabb] : boxes) {
+        auto [it, isNew] = m_queries.try_emplace(key);
+        auto& query = it->second;
+
+        if (isNew) {
+            glGenQueries(1, &query.id);
+        }
+
+        query.usedFrameIndex = frameIndex;
+
+        const AABB box = aabb.expanded(boxMargin);
+
+        const bool containsCamera = glm::all(glm::lessThanEqual(box.min, cameraPosition))
+            && glm::all(glm::greaterThanEqual(box.max, cameraPosition));
+
+        // near plane would clip the box, and a box outside of the frustum passes no samples
+        if (containsCamera || !frustum.intersects(box)) {
+            query.valid = false;
+            query.visible = true;
+            continue;
+        }
+
+        if (query.pending) {
+            continue;
+        }
+
+        const glm::mat4 transform = glm::scale(glm::translate(glm::mat4(1), box.min), box.max - box.min);
+        m_shader->setUniform("transform", transform);
+
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, query.id);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+        query.pending = true;
+        query.valid = true;
+    }
+
+    glBindVertexArray(0);
+
+    glState->apply(PipelineState::opaque());
+}
+
+void OcclusionQueries::addOccludee(const std::shared_ptr<MeshComponent>& mesh) {
+    m_occludees.push_back(mesh);
+}
+
+void OcclusionQueries::removeOccludee(const std::shared_ptr<MeshComponent>& mesh) {
+    std::erase(m_occludees, mesh);
+}
+
+void OcclusionQueries::queryOccludees(const std::shared_ptr<Camera>& camera) {
+    std::vector<std::pair<const void*, AABB>> boxes;
+    boxes.reserve(m_occludees.size());
+
+    for (const auto& mesh : m_occludees) {
+        boxes.emplace_back(mesh.get(), mesh->worldAABB());
+    }
+
+    query(boxes, camera);
+}
+
+bool OcclusionQueries::isVisible(const void* key) const {
+    const auto it = m_queries.find(key);
+
+    return it == m_queries.end() || it->second.visible;
+}
+
+void OcclusionQueries::beginConditionalRender(const void* key) const {
+    if (const auto* query = findValidQuery(key)) {
+        // renders as if visible while the result is not available
+        glBeginConditionalRender(query->id, GL_QUERY_NO_WAIT);
+    }
+}
+
+void OcclusionQueries::endConditionalRender(const void* key) const {
+    if (findValidQuery(key) != nullptr) {
+        glEndConditionalRender();
+    }
+}
+
+void OcclusionQueries::createBox() {
+    // unit box, corners are indexed by bits: 1 - x, 2 - y, 4 - z
+    float vertices[8 * 3];
+
+    for (int i = 0; i < 8; i++) {
+        vertices[i * 3 + 0] = static_cast<float>(i & 1);
+        vertices[i * 3 + 1] = static_cast<float>((i >> 1) & 1);
+        vertices[i * 3 + 2] = static_cast<float>((i >> 2) & 1);
+    }
+
+    constexpr unsigned int indices[] = {
+        0, 2, 3,  0, 3, 1, // -z
+        4, 5, 7,  4, 7, 6, // +z
+        0, 4, 6,  0, 6, 2, // -x
+        1, 3, 7,  1, 7, 5, // +x
+        0, 1, 5,  0, 5, 4, // -y
+        2, 6, 7,  2, 7, 3  // +y
+    };
+
+    glGenVertexArrays(1, &m_boxVAO);
+    glGenBuffers(1, &m_boxVBO);
+    glGenBuffers(1, &m_boxEBO);
+
+    glBindVertexArray(m_boxVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_boxVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_boxEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(VertexFormat::POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+    glEnableVertexAttribArray(VertexFormat::POSITION_LOCATION);
+
+    glBindVertexArray(0);
+}
+
+const OcclusionQueries::Query* OcclusionQueries::findValidQuery(const void* key) const {
+    const auto it = m_queries.find(key);
+
+    return it != m_queries.end() && it->second.valid ? &it->second : nullptr;
+}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bounds.h"
+
+namespace SimpleGL {
+
+class Camera;
+class MeshComponent;
+class ShaderProgram;
+
+/// Hardware occlusion queries of bounding boxes against the depth buffer.
+/// Boxes are drawn with GL_ANY_SAMPLES_PASSED queries after the frame is complete, and their results are used on the next frames:
+/// read back once the GPU has them, never waiting for it, or left to the GPU with conditional rendering.
+/// A new query of a key is issued only after the previous one has finished. Keys are any stable pointers, e.g. meshes.
+class OcclusionQueries {
+public:
+    /// Query boxes are expanded by this margin, so surfaces lying flat on an occluder, like portals, are not hidden by it
+    float boxMargin = 0.05f;
+
+    OcclusionQueries();
+    ~OcclusionQueries();
+
+    OcclusionQueries(const OcclusionQueries&) = delete;
+    OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+
+    /// Collects results of finished queries. Call once per frame before results are used
+    void update();
+
+    /// Draws boxes with color and depth writes disabled inside queries. Must be called after camera's frame is drawn.
+    /// Boxes outside of the frustum or containing the camera are visible without a query
+    void query(const std::vector<std::pair<const void*, AABB>>& boxes, const std::shared_ptr<Camera>& camera);
+
+    /// Large meshes worth to be drawn conditionally, see beginConditionalRender
+    void addOccludee(const std::shared_ptr<MeshComponent>& mesh);
+    void removeOccludee(const std::shared_ptr<MeshComponent>& mesh);
+
+    /// Queries world bounds of all occludees
+    void queryOccludees(const std::shared_ptr<Camera>& camera);
+
+    /// Last known result. Keys which were never queried are visible
+    bool isVisible(const void* key) const;
+
+    /// Draw calls until endConditionalRender are discarded by the GPU if the last finished query of key found its box hidden.
+    /// Results are valid for the camera which issued the queries only. Does nothing for keys without a valid query
+    void beginConditionalRender(const void* key) const;
+    void endConditionalRender(const void* key) const;
+
+private:
+    /// Queries not issued for this number of frames are deleted
+    static constexpr uint64_t MAX_UNUSED_FRAMES = 120;
+
+    struct Query {
+        unsigned int id = 0;
+        /// Query has been issued and its result is not read back yet
+        bool pending = false;
+        /// Last issued query still describes the key, it was not skipped since then
+        bool valid = false;
+        bool visible = true;
+        uint64_t usedFrameIndex = 0;
+    };
+
+    std::unordered_map<const void*, Query> m_queries;
+    std::vector<std::shared_ptr<MeshComponent>> m_occludees;
+
+    std::shared_ptr<ShaderProgram> m_shader;
+
+    unsigned int m_boxVAO = 0;
+    unsigned int m_boxVBO = 0;
+    unsigned int m_boxEBO = 0;
+
+    void createBox();
+
+    const Query* findValidQuery(const void* key) const;
+};
+
+}
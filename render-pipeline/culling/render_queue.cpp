@@ -0,0 +1,152 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "frustum.h"
+#include "occlusion_culler.h"
+#include "spatial_index.h"
+#include "../portal/portal.h"
+#include "../../managers/engine.h"
+#include "../../entities/scene.h"
+#include "../../entities/components/camera.h"
+#include "../../entities/components/mesh.h"
+
+namespace SimpleGL {
+
+void RenderQueue::add(const std::shared_ptr<MeshComponent>& mesh) {
+    if (m_meshes.insert(mesh.get()).second) {
+        m_unindexedMeshes.push_back(mesh);
+    }
+}
+
+void RenderQueue::remove(const std::shared_ptr<MeshComponent>& mesh) {
+    m_meshes.erase(mesh.get());
+    std::erase(m_unindexedMeshes, mesh);
+
+    if (m_indexedMeshes.erase(mesh.get()) > 0) {
+        Engine::get()->scene()->spatialIndex()->remove(mesh);
+    }
+}
+
+const std::vector<std::shared_ptr<MeshComponent>>& RenderQueue::cull(const std::shared_ptr<Camera>& camera) {
+    const auto& spatialIndex = Engine::get()->scene()->spatialIndex();
+    const Frustum frustum(camera->cullingMatrix());
+
+    indexMeshes();
+    spatialIndex->refresh();
+
+    m_insideMeshes.clear();
+    m_intersectingMeshes.clear();
+    m_visibleMeshes.clear();
+
+    spatialIndex->queryFrustum(frustum, m_insideMeshes, m_intersectingMeshes);
+
+    // the index contains every mesh of the scene, only registered ones are drawn
+    const auto isNotRegistered = [this](const std::shared_ptr<MeshComponent>& mesh) {
+        return !m_meshes.contains(mesh.get());
+    };
+
+    std::erase_if(m_insideMeshes, isNotRegistered);
+    std::erase_if(m_intersectingMeshes, isNotRegistered);
+
+    m_visibleMeshes.insert(m_visibleMeshes.end(), m_insideMeshes.begin(), m_insideMeshes.end());
+
+    cullIntersecting(frustum);
+
+    if (usesOcclusionCuller(camera)) {
+        m_occlusionCuller->render(camera);
+
+        std::erase_if(m_visibleMeshes, [this](const std::shared_ptr<MeshComponent>& mesh) {
+            return !m_occlusionCuller->isVisible(mesh->worldAABB());
+        });
+    }
+
+    // consecutive draws share shaders and materials
+    std::ranges::sort(m_visibleMeshes, {}, [](const std::shared_ptr<MeshComponent>& mesh) { return mesh->sortKey(); });
+
+    return m_visibleMeshes;
+}
+
+void RenderQueue::indexMeshes() {
+    const auto& spatialIndex = Engine::get()->scene()->spatialIndex();
+
+    for (const auto& mesh : m_unindexedMeshes) {
+        if (!spatialIndex->contains(mesh.get())) {
+            spatialIndex->add(mesh);
+            m_indexedMeshes.insert(mesh.get());
+        }
+    }
+
+    m_unindexedMeshes.clear();
+}
+
+bool RenderQueue::usesOcclusionCuller(const std::shared_ptr<Camera>& camera) const {
+    return m_occlusionCuller != nullptr && Portal::screenCoverage(camera->screenRect()) >= m_occlusionMinScreenCoverage;
+}
+
+void RenderQueue::cullIntersecting(const Frustum& frustum) {
+    BoundsBatch batch;
+
+    for (size_t first = 0; first < m_intersectingMeshes.size(); first += BATCH_SIZE) {
+        const size_t count = std::min<size_t>(BATCH_SIZE, m_intersectingMeshes.size() - first);
+
+        fillBatch(batch, m_intersectingMeshes, first, count);
+
+        bool visible[BATCH_SIZE];
+        cullBatch(batch, frustum, visible);
+
+        for (size_t i = 0; i < count; i++) {
+            if (visible[i]) {
+                m_visibleMeshes.push_back(m_intersectingMeshes[first + i]);
+            }
+        }
+    }
+}
+
+void RenderQueue::fillBatch(
+    BoundsBatch& batch,
+    const std::vector<std::shared_ptr<MeshComponent>>& meshes,
+    size_t first,
+    size_t count
+) {
+    for (size_t lane = 0; lane < BATCH_SIZE; lane++) {
+        // unused lanes of the last batch are never read, but are kept deterministic
+        const auto aabb = lane < count ? meshes[first + lane]->worldAABB() : AABB();
+        const glm::vec3 center = aabb.center();
+        const glm::vec3 extents = aabb.extents();
+
+        batch.centerX[lane] = center.x;
+        batch.centerY[lane] = center.y;
+        batch.centerZ[lane] = center.z;
+        batch.extentX[lane] = extents.x;
+        batch.extentY[lane] = extents.y;
+        batch.extentZ[lane] = extents.z;
+    }
+}
+
+void RenderQueue::cullBatch(const BoundsBatch& batch, const Frustum& frustum, bool (&visible)[BATCH_SIZE]) {
+    // only the sign matters, so distances are clamped to 0 from above
+    float minDistance[BATCH_SIZE];
+    std::fill(std::begin(minDistance), std::end(minDistance), 0.f);
+
+    // branchless inner loop over lanes, vectorized by the compiler
+    for (const auto& plane : frustum.planes()) {
+        const float absX = std::abs(plane.x);
+        const float absY = std::abs(plane.y);
+        const float absZ = std::abs(plane.z);
+
+        for (unsigned int lane = 0; lane < BATCH_SIZE; lane++) {
+            const float distance = plane.x * batch.centerX[lane] + plane.y * batch.centerY[lane] + plane.z * batch.centerZ[lane] + plane.w;
+            const float radius = absX * batch.extentX[lane] + absY * batch.extentY[lane] + absZ * batch.extentZ[lane];
+
+            minDistance[lane] = std::min(minDistance[lane], distance + radius);
+        }
+    }
+
+    for (unsigned int lane = 0; lane < BATCH_SIZE; lane++) {
+        visible[lane] = minDistance[lane] >= 0;
+    }
+}
+
+}
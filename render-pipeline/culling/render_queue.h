@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+namespace SimpleGL {
+
+class Camera;
+class Frustum;
+class MeshComponent;
+class OcclusionCuller;
+
+/// Frustum culls registered meshes before they are drawn.
+/// Candidates come from the scene's spatial index. Registered meshes missing from it, e.g. created after the scene start,
+/// are added to it on the next cull and removed from it with the queue. Meshes whose tree nodes only intersect the frustum
+/// are tested once more with their tight bounds, stored as structure of arrays in batches of BATCH_SIZE,
+/// so the compiler can test a whole batch against a plane with vector instructions.
+/// Survivors are optionally tested against software-rasterized occluders. Rasterizing costs the same for any view,
+/// so only views covering a large enough part of the screen use it, e.g. the main camera but not small portal views.
+/// Visible meshes are sorted by their sort keys, grouping draws by shader and material.
+class RenderQueue {
+public:
+    static constexpr unsigned int BATCH_SIZE = 8;
+
+    void add(const std::shared_ptr<MeshComponent>& mesh);
+    void remove(const std::shared_ptr<MeshComponent>& mesh);
+
+    /// Meshes passing the frustum test are also tested against occluders, if the culler is set,
+    /// for cameras whose screen rect covers at least minScreenCoverage of the screen. Full screen cameras always do
+    void setOcclusionCuller(const std::shared_ptr<OcclusionCuller>& occlusionCuller, float minScreenCoverage = 1.f) {
+        m_occlusionCuller = occlusionCuller;
+        m_occlusionMinScreenCoverage = minScreenCoverage;
+    }
+
+    /// Returns meshes whose bounds intersect camera's frustum, sorted by MeshComponent::sortKey.
+    /// The result is valid until the next cull call
+    const std::vector<std::shared_ptr<MeshComponent>>& cull(const std::shared_ptr<Camera>& camera);
+
+private:
+    struct alignas(32) BoundsBatch {
+        float centerX[BATCH_SIZE];
+        float centerY[BATCH_SIZE];
+        float centerZ[BATCH_SIZE];
+        float extentX[BATCH_SIZE];
+        float extentY[BATCH_SIZE];
+        float extentZ[BATCH_SIZE];
+    };
+
+    std::unordered_set<const MeshComponent*> m_meshes;
+
+    /// Registered meshes not checked against the spatial index yet, it may not exist when they are added
+    std::vector<std::shared_ptr<MeshComponent>> m_unindexedMeshes;
+
+    /// Meshes added to the spatial index by the queue rather than by the scene
+    std::unordered_set<const MeshComponent*> m_indexedMeshes;
+    std::shared_ptr<OcclusionCuller> m_occlusionCuller;
+    float m_occlusionMinScreenCoverage = 1.f;
+
+    std::vector<std::shared_ptr<MeshComponent>> m_insideMeshes;
+    std::vector<std::shared_ptr<MeshComponent>> m_intersectingMeshes;
+    std::vector<std::shared_ptr<MeshComponent>> m_visibleMeshes;
+
+    void indexMeshes();
+
+    void cullIntersecting(const Frustum& frustum);
+
+    bool usesOcclusionCuller(const std::shared_ptr<Camera>& camera) const;
+
+    static void fillBatch(
+        BoundsBatch& batch,
+        const std::vector<std::shared_ptr<MeshComponent>>& meshes,
+        size_t first,
+        size_t count
+    );
+
+    static void cullBatch(const BoundsBatch& batch, const Frustum& frustum, bool (&visible)[BATCH_SIZE]);
+};
+
+}
@@ -0,0 +1,168 @@
+#include "spatial_index.h"
+
+#include "frustum.h"
+#include "../../managers/engine.h"
+#include "../../entities/node.h"
+#include "../../entities/components/mesh.h"
+#include "../../entities/components/transform.h"
+#include "../../window/window.h"
+#include "../../window/input.h"
+
+namespace SimpleGL {
+
+SpatialIndex::SpatialIndex():
+    m_dynamicTree(0.1f),
+    m_staticTree(0.f)
+{}
+
+void SpatialIndex::add(const std::shared_ptr<MeshComponent>& mesh) {
+    const int entryIndex = static_cast<int>(m_entries.size());
+
+    if (!m_entryIndices.try_emplace(mesh.get(), entryIndex).second) {
+        return;
+    }
+
+    const bool isStatic = SpatialIndex::isStatic(mesh->node());
+
+    m_entries.push_back({ mesh, AABBTree::NULL_NODE, isStatic, mesh->transform()->version() });
+
+    auto& entry = m_entries.back();
+    entry.proxy = tree(entry).insert(mesh->worldAABB(), entryIndex);
+
+    m_staticTreeDirty |= isStatic;
+}
+
+void SpatialIndex::remove(const std::shared_ptr<MeshComponent>& mesh) {
+    const auto it = m_entryIndices.find(mesh.get());
+
+    if (it == m_entryIndices.end()) {
+        return;
+    }
+
+    const int i = it->second;
+    m_entryIndices.erase(it);
+
+    tree(m_entries[i]).remove(m_entries[i].proxy);
+    m_staticTreeDirty |= m_entries[i].isStatic;
+
+    // the last entry takes place of the removed one
+    if (i != static_cast<int>(m_entries.size()) - 1) {
+        m_entries[i] = std::move(m_entries.back());
+        tree(m_entries[i]).setUserData(m_entries[i].proxy, i);
+        m_entryIndices[m_entries[i].mesh.get()] = i;
+    }
+
+    m_entries.pop_back();
+}
+
+void SpatialIndex::refresh() {
+    const uint64_t frameIndex = Engine::get()->window()->input()->frameIndex();
+
+    if (frameIndex == m_refreshFrameIndex) {
+        return;
+    }
+
+    m_refreshFrameIndex = frameIndex;
+
+    if (m_dynamicTree.applyRebuild()) {
+        m_dynamicTreeBuildCost = m_dynamicTree.cost();
+    }
+
+    for (auto& entry : m_entries) {
+        const uint64_t version = entry.mesh->transform()->version();
+
+        if (version == entry.transformVersion) {
+            continue;
+        }
+
+        entry.transformVersion = version;
+
+        if (tree(entry).update(entry.proxy, entry.mesh->worldAABB())) {
+            m_staticTreeDirty |= entry.isStatic;
+        }
+    }
+
+    if (m_staticTreeDirty) {
+        m_staticTree.rebuild();
+        m_staticTreeDirty = false;
+    }
+
+    if (!m_dynamicTreeBuilt) {
+        m_dynamicTree.rebuild();
+        m_dynamicTreeBuildCost = m_dynamicTree.cost();
+        m_dynamicTreeBuilt = true;
+    }
+    else if (!m_dynamicTree.isRebuilding() && m_dynamicTree.cost() > m_dynamicTreeBuildCost * REBUILD_COST_RATIO) {
+        m_dynamicTree.rebuildAsync();
+    }
+}
+
+void SpatialIndex::queryFrustum(
+    const Frustum& frustum,
+    std::vector<std::shared_ptr<MeshComponent>>& inside,
+    std::vector<std::shared_ptr<MeshComponent>>& intersecting
+) {
+    m_insideBuffer.clear();
+    m_intersectingBuffer.clear();
+
+    m_staticTree.queryFrustum(frustum, m_insideBuffer, m_intersectingBuffer);
+    m_dynamicTree.queryFrustum(frustum, m_insideBuffer, m_intersectingBuffer);
+
+    for (const int entryIndex : m_insideBuffer) {
+        inside.push_back(m_entries[entryIndex].mesh);
+    }
+
+    for (const int entryIndex : m_intersectingBuffer) {
+        intersecting.push_back(m_entries[entryIndex].mesh);
+    }
+}
+
+void SpatialIndex::queryDynamicFrustum(const Frustum& frustum, std::vector<std::shared_ptr<MeshComponent>>& result) {
+    m_insideBuffer.clear();
+    m_intersectingBuffer.clear();
+
+    m_dynamicTree.queryFrustum(frustum, m_insideBuffer, m_intersectingBuffer);
+
+    for (const int entryIndex : m_insideBuffer) {
+        result.push_back(m_entries[entryIndex].mesh);
+    }
+
+    for (const int entryIndex : m_intersectingBuffer) {
+        result.push_back(m_entries[entryIndex].mesh);
+    }
+}
+
+void SpatialIndex::querySphere(const BoundingSphere& sphere, std::vector<std::shared_ptr<MeshComponent>>& result) {
+    const auto callback = [this, &result](int entryIndex) {
+        result.push_back(m_entries[entryIndex].mesh);
+    };
+
+    m_staticTree.querySphere(sphere, callback);
+    m_dynamicTree.querySphere(sphere, callback);
+}
+
+void SpatialIndex::queryRay(
+    const glm::vec3& origin,
+    const glm::vec3& direction,
+    float maxDistance,
+    std::vector<std::shared_ptr<MeshComponent>>& result
+) {
+    const auto callback = [this, &result](int entryIndex) {
+        result.push_back(m_entries[entryIndex].mesh);
+    };
+
+    m_staticTree.queryRay(origin, direction, maxDistance, callback);
+    m_dynamicTree.queryRay(origin, direction, maxDistance, callback);
+}
+
+bool SpatialIndex::isStatic(const std::shared_ptr<Node>& node) {
+    for (auto currentNode = node; currentNode != nullptr; currentNode = currentNode->parent()) {
+        if (currentNode->isStatic) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "aabb_tree.h"
+
+namespace SimpleGL {
+
+class Frustum;
+class MeshComponent;
+class Node;
+
+/// Scene-wide bounding volume hierarchy of meshes.
+/// Meshes of static subtrees (see Node::isStatic) are kept in a separate tree with tight bounds,
+/// which is rebuilt only when static content changes. Other meshes are kept in a dynamic tree
+/// refitted from transform changes and rebuilt in background when its quality degrades.
+class SpatialIndex {
+public:
+    SpatialIndex();
+
+    /// Does nothing if the mesh is already indexed
+    void add(const std::shared_ptr<MeshComponent>& mesh);
+    void remove(const std::shared_ptr<MeshComponent>& mesh);
+
+    bool contains(const MeshComponent* mesh) const { return m_entryIndices.contains(mesh); }
+
+    /// Applies transform changes to the trees. Does nothing if it was already called this frame
+    void refresh();
+
+    void queryFrustum(
+        const Frustum& frustum,
+        std::vector<std::shared_ptr<MeshComponent>>& inside,
+        std::vector<std::shared_ptr<MeshComponent>>& intersecting
+    );
+
+    /// Meshes of the dynamic tree only, by their fat bounds
+    void queryDynamicFrustum(const Frustum& frustum, std::vector<std::shared_ptr<MeshComponent>>& result);
+
+    void querySphere(const BoundingSphere& sphere, std::vector<std::shared_ptr<MeshComponent>>& result);
+
+    /// Returns meshes whose bounds are hit by the ray, in no particular order
+    void queryRay(
+        const glm::vec3& origin,
+        const glm::vec3& direction,
+        float maxDistance,
+        std::vector<std::shared_ptr<MeshComponent>>& result
+    );
+
+private:
+    struct Entry {
+        std::shared_ptr<MeshComponent> mesh;
+        int proxy;
+        bool isStatic;
+        uint64_t transformVersion;
+    };
+
+    /// Dynamic tree is rebuilt when its cost grows by this factor since the last rebuild
+    static constexpr float REBUILD_COST_RATIO = 1.5f;
+
+    std::vector<Entry> m_entries;
+
+    /// Index of every mesh's entry in m_entries
+    std::unordered_map<const MeshComponent*, int> m_entryIndices;
+
+    AABBTree m_dynamicTree;
+    AABBTree m_staticTree;
+
+    float m_dynamicTreeBuildCost = 0;
+    bool m_dynamicTreeBuilt = false;
+    bool m_staticTreeDirty = false;
+
+    uint64_t m_refreshFrameIndex = -1;
+
+    std::vector<int> m_insideBuffer;
+    std::vector<int> m_intersectingBuffer;
+
+    AABBTree& tree(const Entry& entry) { return entry.isStatic ? m_staticTree : m_dynamicTree; }
+
+    static bool isStatic(const std::shared_ptr<Node>& node);
+};
+
+}
@@ -0,0 +1,184 @@
+#include "deferred_renderer.h"
+
+#include <glad/glad.h>
+
+#include "g_buffer.h"
+#include "../../managers/engine.h"
+#include "../../managers/mesh_manager.h"
+#include "../../managers/shader_manager.h"
+#include "../../entities/node.h"
+#include "../../entities/scene.h"
+#include "../../entities/shader_program.h"
+#include "../../entities/components/camera.h"
+#include "../../entities/components/light.h"
+#include "../../entities/components/mesh.h"
+#include "../../entities/components/transform.h"
+#include "../state/gl_state_cache.h"
+
+namespace SimpleGL {
+
+DeferredRenderer* DeferredRenderer::s_active = nullptr;
+
+DeferredRenderer::DeferredRenderer(int width, int height) {
+    m_gBuffer = std::make_unique<GBuffer>(width, height);
+    m_views.reserve(MAX_VIEWS);
+
+    initDirectLightPass();
+    initPointLightPass();
+}
+
+DeferredRenderer::~DeferredRenderer() {
+    if (s_active == this) {
+        s_active = nullptr;
+    }
+}
+
+void DeferredRenderer::beginGeometryPass() {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_gBuffer->FBO());
+
+    m_views.clear();
+    s_active = this;
+}
+
+void DeferredRenderer::endGeometryPass() {
+    s_active = nullptr;
+}
+
+void DeferredRenderer::lightingPass(unsigned int targetFBO) {
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+
+    const auto& glState = Engine::get()->glState();
+
+    // unlit pixels and direct lights
+    glState->apply(PipelineState::fullscreen());
+
+    m_quadMesh->draw();
+
+    // point light volumes. Back faces are drawn, so volumes containing the camera are still rasterized
+    static constexpr PipelineState lightVolumesState = [] {
+        PipelineState state = PipelineState::fullscreen();
+        state.cullFace = true;
+        state.cullFaceMode = GL_FRONT;
+        state.blend = true;
+        state.blendDestination = GL_ONE;
+        return state;
+    }();
+
+    glState->apply(lightVolumesState);
+
+    // scale compensates for the sphere mesh being inscribed in the unit sphere
+    constexpr float volumeScale = 1.05f;
+
+    for (const auto& weakLight : Engine::get()->scene()->pointLights()) {
+        m_currentLight = weakLight.lock();
+
+        m_lightVolumeNode->transform()->setPosition(m_currentLight->transform()->absolutePosition());
+        m_lightVolumeNode->transform()->setScale(m_currentLight->distance * volumeScale);
+        m_lightVolumeNode->transform()->recalculateDetached();
+
+        for (m_currentViewIndex = 0; m_currentViewIndex < static_cast<int>(m_views.size()); m_currentViewIndex++) {
+            m_lightVolumeMesh->draw();
+        }
+    }
+
+    m_currentLight = nullptr;
+
+    glState->setEnabled(GL_BLEND, false);
+    glState->setCullFace(GL_BACK);
+}
+
+int DeferredRenderer::registerView(const std::shared_ptr<Camera>& camera) {
+    const auto& viewMatrix = camera->viewMatrix();
+    const auto& projectionMatrix = camera->projectionMatrix();
+
+    // meshes are drawn camera by camera, so the latest view is the most likely match
+    for (int i = static_cast<int>(m_views.size()) - 1; i >= 0; i--) {
+        if (m_views[i].viewMatrix == viewMatrix && m_views[i].projectionMatrix == projectionMatrix) {
+            return i;
+        }
+    }
+
+    // views above the limit overwrite the last one, their pixels are lit with a wrong camera
+    if (m_views.size() == MAX_VIEWS) {
+        m_views.pop_back();
+    }
+
+    const auto viewProjection = projectionMatrix * viewMatrix;
+
+    m_views.push_back({
+        viewMatrix,
+        projectionMatrix,
+        viewProjection,
+        glm::inverse(viewProjection),
+        glm::vec3(glm::inverse(viewMatrix)[3])
+    });
+
+    return static_cast<int>(m_views.size()) - 1;
+}
+
+void DeferredRenderer::initDirectLightPass() {
+    m_directLightShader = Engine::get()->shaderManager()->createShaderProgram(
+        "shaders/frame/vertex.glsl",
+        "shaders/deferred/direct-light-fragment.glsl",
+        "deferred direct light shader"
+    );
+
+    m_quadNode = Engine::get()->meshManager()->createNodeFromMeshData("plane.obj");
+    m_quadNode->transform()->recalculateDetached();
+
+    m_quadMesh = m_quadNode->getComponent<MeshComponent>();
+    m_quadMesh->setShader(m_directLightShader);
+    m_quadMesh->setBeforeDrawCallback([this](const std::shared_ptr<ShaderProgram>& shaderProgram) {
+        setGBufferTextures(shaderProgram);
+
+        std::vector<glm::mat4> inverseViewProjections;
+        std::vector<glm::vec3> positions;
+
+        for (const auto& view : m_views) {
+            inverseViewProjections.push_back(view.inverseViewProjection);
+            positions.push_back(view.position);
+        }
+
+        if (!m_views.empty()) {
+            shaderProgram->setUniform("viewInverseViewProjections[0]", inverseViewProjections);
+            shaderProgram->setUniform("viewPositions[0]", positions);
+        }
+    });
+}
+
+void DeferredRenderer::initPointLightPass() {
+    m_pointLightShader = Engine::get()->shaderManager()->createShaderProgram(
+        "shaders/deferred/point-light-vertex.glsl",
+        "shaders/deferred/point-light-fragment.glsl",
+        "deferred point light shader"
+    );
+
+    m_lightVolumeNode = Engine::get()->meshManager()->createNodeFromMeshData("sphere.obj");
+
+    m_lightVolumeMesh = m_lightVolumeNode->getComponent<MeshComponent>();
+    m_lightVolumeMesh->setShader(m_pointLightShader);
+    m_lightVolumeMesh->setBeforeDrawCallback([this](const std::shared_ptr<ShaderProgram>& shaderProgram) {
+        const auto& view = m_views[m_currentViewIndex];
+
+        setGBufferTextures(shaderProgram);
+
+        shaderProgram->setUniform("volumeViewIndex", m_currentViewIndex);
+        shaderProgram->setUniform("volumeViewProjection", view.viewProjection);
+        shaderProgram->setUniform("volumeInverseViewProjection", view.inverseViewProjection);
+        shaderProgram->setUniform("volumeViewPosition", view.position);
+
+        shaderProgram->setUniform("lightPosition", m_currentLight->transform()->absolutePosition());
+        shaderProgram->setUniform("lightDistance", m_currentLight->distance);
+        shaderProgram->setUniform("lightAmbient", m_currentLight->ambient);
+        shaderProgram->setUniform("lightDiffuse", m_currentLight->diffuse);
+        shaderProgram->setUniform("lightSpecular", m_currentLight->specular);
+    });
+}
+
+void DeferredRenderer::setGBufferTextures(const std::shared_ptr<ShaderProgram>& shaderProgram) const {
+    shaderProgram->setTexture("gAlbedoSpecular", m_gBuffer->albedoSpecularTextureId());
+    shaderProgram->setTexture("gNormal", m_gBuffer->normalTextureId());
+    shaderProgram->setTexture("gDepth", m_gBuffer->depthStencilTextureId());
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace SimpleGL {
+
+class Camera;
+class GBuffer;
+class Node;
+class MeshComponent;
+class PointLight;
+class ShaderProgram;
+
+/// Deferred render path.
+/// Geometry pass renders meshes with g-buffer variants of their shaders, light accumulation pass
+/// adds direct lights in a fullscreen pass and point lights as light volumes into the target frame buffer.
+///
+/// Portals render several cameras into the same g-buffer, so every lit pixel stores index of the view it was rendered with.
+/// Light volumes are drawn once per view and only shade pixels of that view.
+class DeferredRenderer {
+public:
+    /// Must match MAX_VIEWS_NUM define in the deferred light shaders
+    static constexpr unsigned int MAX_VIEWS = 32;
+
+    DeferredRenderer(int width, int height);
+    ~DeferredRenderer();
+
+    /// Renderer whose geometry pass is in progress. Meshes use g-buffer shader variants while it is set.
+    static DeferredRenderer* active() { return s_active; }
+    static void setActive(DeferredRenderer* renderer) { s_active = renderer; }
+
+    void beginGeometryPass();
+    void endGeometryPass();
+
+    /// Accumulates lighting into the bound color attachment of targetFBO
+    void lightingPass(unsigned int targetFBO);
+
+    /// Returns index of camera's current view, registering it if needed
+    int registerView(const std::shared_ptr<Camera>& camera);
+
+private:
+    struct View {
+        glm::mat4 viewMatrix;
+        glm::mat4 projectionMatrix;
+        glm::mat4 viewProjection;
+        glm::mat4 inverseViewProjection;
+        glm::vec3 position;
+    };
+
+    static DeferredRenderer* s_active;
+
+    std::unique_ptr<GBuffer> m_gBuffer;
+
+    std::vector<View> m_views;
+
+    std::shared_ptr<Node> m_quadNode;
+    std::shared_ptr<MeshComponent> m_quadMesh;
+    std::shared_ptr<ShaderProgram> m_directLightShader;
+
+    std::shared_ptr<Node> m_lightVolumeNode;
+    std::shared_ptr<MeshComponent> m_lightVolumeMesh;
+    std::shared_ptr<ShaderProgram> m_pointLightShader;
+
+    std::shared_ptr<PointLight> m_currentLight;
+    int m_currentViewIndex = 0;
+
+    void initDirectLightPass();
+    void initPointLightPass();
+
+    void setGBufferTextures(const std::shared_ptr<ShaderProgram>& shaderProgram) const;
+};
+
+}
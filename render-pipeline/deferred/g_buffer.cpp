@@ -0,0 +1,41 @@
+#include "g_buffer.h"
+
+#include <stdexcept>
+#include <glad/glad.h>
+
+namespace SimpleGL {
+
+GBuffer::GBuffer(int width, int height)
+    : BaseFrameBuffer(width, height, false, 1)
+{
+    m_albedoSpecularTextureId = createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+    m_normalTextureId = createTexture(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+    m_depthStencilTextureId = createTexture(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+
+    bindTexturesToFBO();
+}
+
+GBuffer::~GBuffer() {
+    glDeleteTextures(1, &m_albedoSpecularTextureId);
+    glDeleteTextures(1, &m_normalTextureId);
+    glDeleteTextures(1, &m_depthStencilTextureId);
+}
+
+void GBuffer::bindTexturesToFBO() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_albedoSpecularTextureId, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_normalTextureId, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthStencilTextureId, 0);
+
+    constexpr GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error("G-BUFFER is incomplete");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../../window/framebuffers/base_frame_buffer.h"
+
+namespace SimpleGL {
+
+/// Geometry buffer of the deferred render path:
+/// - albedoSpecular: RGBA8, albedo color and specular intensity
+/// - normal: RGBA16F, octahedral-packed world normal, shading model (0 - unlit, 1 - lit) and view index
+/// - depthStencil: depth is used to reconstruct positions, stencil is used by portals
+class GBuffer : public BaseFrameBuffer {
+public:
+    GBuffer(int width, int height);
+    ~GBuffer();
+
+    unsigned int albedoSpecularTextureId() const { return m_albedoSpecularTextureId; }
+    unsigned int normalTextureId() const { return m_normalTextureId; }
+    unsigned int depthStencilTextureId() const { return m_depthStencilTextureId; }
+
+private:
+    unsigned int m_albedoSpecularTextureId = 0;
+    unsigned int m_normalTextureId = 0;
+    unsigned int m_depthStencilTextureId = 0;
+
+    void bindTexturesToFBO() const;
+};
+
+}
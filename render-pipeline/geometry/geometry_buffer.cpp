@@ -0,0 +1,130 @@
+#include "geometry_buffer.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "vertex_format.h"
+#include "../../entities/mesh_data.h"
+
+namespace SimpleGL {
+
+GeometryBuffer::GeometryBuffer() {
+    glGenVertexArrays(1, &m_VAO);
+
+    std::vector<unsigned int> drawIds(MAX_DRAWS);
+    std::iota(drawIds.begin(), drawIds.end(), 0u);
+
+    glGenBuffers(1, &m_drawIdBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_drawIdBuffer);
+    glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(unsigned int), drawIds.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    reserve(INITIAL_VERTEX_CAPACITY, INITIAL_INDEX_CAPACITY);
+}
+
+GeometryBuffer::~GeometryBuffer() {
+    glDeleteVertexArrays(1, &m_VAO);
+    glDeleteBuffers(1, &m_VBO);
+    glDeleteBuffers(1, &m_EBO);
+    glDeleteBuffers(1, &m_drawIdBuffer);
+}
+
+const GeometryBuffer::Range& GeometryBuffer::allocate(const std::shared_ptr<MeshData>& meshData) {
+    if (const auto it = m_ranges.find(meshData); it != m_ranges.end()) {
+        return it->second;
+    }
+
+    const auto& vertices = meshData->vertices();
+    const auto& indices = meshData->indices();
+
+    const auto vertexCount = static_cast<unsigned int>(vertices.size() / VERTEX_SIZE);
+    const auto indexCount = static_cast<unsigned int>(indices.size());
+
+    reserve(m_vertexCount + vertexCount, m_indexCount + indexCount);
+
+    constexpr long vertexBytes = VERTEX_SIZE * sizeof(float);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, m_vertexCount * vertexBytes, vertexCount * vertexBytes, vertices.data());
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_EBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, m_indexCount * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices.data());
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // indices stay relative to the mesh, draws add the base vertex
+    const Range range = { static_cast<int>(m_vertexCount), m_indexCount, indexCount };
+
+    m_vertexCount += vertexCount;
+    m_indexCount += indexCount;
+
+    return m_ranges.emplace(meshData, range).first->second;
+}
+
+void GeometryBuffer::reserve(unsigned int vertexCount, unsigned int indexCount) {
+    if (vertexCount <= m_vertexCapacity && indexCount <= m_indexCapacity) {
+        return;
+    }
+
+    constexpr long vertexBytes = VERTEX_SIZE * sizeof(float);
+
+    if (vertexCount > m_vertexCapacity) {
+        const unsigned int capacity = std::max(vertexCount, m_vertexCapacity * 2);
+
+        m_VBO = growBuffer(m_VBO, m_vertexCount * vertexBytes, capacity * vertexBytes);
+        m_vertexCapacity = capacity;
+    }
+
+    if (indexCount > m_indexCapacity) {
+        const unsigned int capacity = std::max(indexCount, m_indexCapacity * 2);
+
+        m_EBO = growBuffer(m_EBO, m_indexCount * sizeof(unsigned int), capacity * sizeof(unsigned int));
+        m_indexCapacity = capacity;
+    }
+
+    setupVAO();
+}
+
+void GeometryBuffer::setupVAO() const {
+    glBindVertexArray(m_VAO);
+
+    VertexFormat::standard().apply({ m_VBO });
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_drawIdBuffer);
+
+    glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(unsigned int), nullptr);
+    glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+    glEnableVertexAttribArray(DRAW_ID_LOCATION);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+unsigned int GeometryBuffer::growBuffer(unsigned int buffer, long usedSize, long newSize) {
+    unsigned int result;
+    glGenBuffers(1, &result);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, result);
+    glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+
+    if (buffer != 0 && usedSize > 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (buffer != 0) {
+        glDeleteBuffers(1, &buffer);
+    }
+
+    return result;
+}
+
+}
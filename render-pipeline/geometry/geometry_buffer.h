@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+
+namespace SimpleGL {
+
+struct MeshData;
+
+/// Vertices and indices of many meshes suballocated from one large vertex buffer and one index buffer,
+/// sharing the standard VertexFormat and a single VAO. Meshes are uploaded on their first allocation and stay until
+/// the buffer is destroyed. Full buffers grow by doubling, old contents are copied on the GPU.
+class GeometryBuffer {
+public:
+    /// Per-draw attribute with divisor 1 read from a buffer of 0, 1, 2...
+    /// Indirect draws pass their index as base instance, so the attribute holds the draw's index
+    static constexpr int DRAW_ID_LOCATION = 3;
+    static constexpr unsigned int MAX_DRAWS = 4096;
+
+    /// Position, texture coordinates and normal in floats
+    static constexpr int VERTEX_SIZE = 8;
+
+    struct Range {
+        int baseVertex = 0;
+        unsigned int firstIndex = 0;
+        unsigned int indexCount = 0;
+    };
+
+    GeometryBuffer();
+    ~GeometryBuffer();
+
+    GeometryBuffer(const GeometryBuffer&) = delete;
+    GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+
+    /// Range of meshData in the buffers, uploaded on the first call
+    const Range& allocate(const std::shared_ptr<MeshData>& meshData);
+
+    unsigned int VAO() const { return m_VAO; }
+
+private:
+    static constexpr unsigned int INITIAL_VERTEX_CAPACITY = 1 << 16;
+    static constexpr unsigned int INITIAL_INDEX_CAPACITY = 3 << 16;
+
+    std::unordered_map<std::shared_ptr<MeshData>, Range> m_ranges;
+
+    unsigned int m_VAO = 0;
+    unsigned int m_VBO = 0;
+    unsigned int m_EBO = 0;
+    unsigned int m_drawIdBuffer = 0;
+
+    unsigned int m_vertexCount = 0;
+    unsigned int m_vertexCapacity = 0;
+    unsigned int m_indexCount = 0;
+    unsigned int m_indexCapacity = 0;
+
+    void reserve(unsigned int vertexCount, unsigned int indexCount);
+
+    void setupVAO() const;
+
+    /// Returns a new buffer of newSize bytes holding first usedSize bytes of buffer, which is deleted
+    static unsigned int growBuffer(unsigned int buffer, long usedSize, long newSize);
+};
+
+}
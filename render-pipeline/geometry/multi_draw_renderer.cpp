@@ -0,0 +1,336 @@
+#include "multi_draw_renderer.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "../culling/frustum.h"
+#include "../deferred/deferred_renderer.h"
+#include "../../managers/engine.h"
+#include "../../managers/mesh_manager.h"
+#include "../../managers/shader_manager.h"
+#include "../../entities/node.h"
+#include "../../entities/shader_program.h"
+#include "../../entities/components/mesh.h"
+#include "../../entities/components/camera.h"
+#include "../../entities/components/transform.h"
+#include "../../window/input.h"
+#include "../../window/window.h"
+
+namespace SimpleGL {
+
+bool MultiDrawRenderer::isSupported() {
+#ifdef GL_VERSION_4_3
+    return GLAD_GL_VERSION_4_3 && RingBuffer::isSupported();
+#else
+    return false;
+#endif
+}
+
+#ifdef GL_VERSION_4_3
+
+MultiDrawRenderer::MultiDrawRenderer() {
+    if (!isSupported()) {
+        throw std::runtime_error("MULTI DRAW RENDERER. OpenGL 4.3 with buffer storage is not supported");
+    }
+
+    m_shader = Engine::get()->shaderManager()->createShaderProgram(
+        "shaders/multi-draw/vertex.glsl",
+        "shaders/multi-draw/fragment.glsl",
+        "multi-draw shader program",
+        LightingFeature | ClusteredFeature
+    );
+
+    m_cullShader = Engine::get()->shaderManager()->createComputeProgram(
+        "shaders/multi-draw/cull-compute.glsl",
+        "multi-draw cull compute program"
+    );
+
+    m_ring = std::make_unique<RingBuffer>(RING_FRAME_SIZE);
+
+    int uniformAlignment = 0;
+    int storageAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+
+    m_uniformAlignment = uniformAlignment;
+    m_storageAlignment = storageAlignment;
+
+    glGenBuffers(1, &m_instanceBuffer);
+    glGenBuffers(1, &m_instanceDrawDataBuffer);
+    glGenBuffers(1, &m_culledCommandBuffer);
+    glGenBuffers(1, &m_drawCountBuffer);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_culledCommandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, GeometryBuffer::MAX_DRAWS * sizeof(DrawCommand), nullptr, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawCountBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    m_commands.reserve(GeometryBuffer::MAX_DRAWS);
+    m_drawData.reserve(GeometryBuffer::MAX_DRAWS);
+}
+
+MultiDrawRenderer::~MultiDrawRenderer() {
+    glDeleteBuffers(1, &m_instanceBuffer);
+    glDeleteBuffers(1, &m_instanceDrawDataBuffer);
+    glDeleteBuffers(1, &m_culledCommandBuffer);
+    glDeleteBuffers(1, &m_drawCountBuffer);
+}
+
+void MultiDrawRenderer::add(const std::shared_ptr<MeshComponent>& mesh, const glm::vec3& color) {
+    const auto& range = Engine::get()->meshManager()->geometryBuffer()->allocate(mesh->meshData());
+
+    m_entries[mesh.get()] = { mesh, range, color };
+    m_instancesChanged = true;
+}
+
+void MultiDrawRenderer::remove(const std::shared_ptr<MeshComponent>& mesh) {
+    m_entries.erase(mesh.get());
+    m_instancesChanged = true;
+}
+
+bool MultiDrawRenderer::submit(const std::shared_ptr<MeshComponent>& mesh) {
+    const auto it = m_entries.find(mesh.get());
+
+    if (it == m_entries.end()) {
+        return false;
+    }
+
+    if (gpuCulling || mesh->node()->visible == false) {
+        return true;
+    }
+
+    if (m_commands.size() == GeometryBuffer::MAX_DRAWS) {
+        return false;
+    }
+
+    const auto& range = it->second.range;
+    const auto& color = it->second.color;
+
+    // base instance selects the draw id, see GeometryBuffer::DRAW_ID_LOCATION
+    m_commands.push_back({
+        range.indexCount,
+        1,
+        range.firstIndex,
+        range.baseVertex,
+        static_cast<unsigned int>(m_commands.size())
+    });
+
+    m_drawData.push_back({ mesh->transform()->transformMatrix(), glm::vec4(color, 1.f) });
+
+    return true;
+}
+
+void MultiDrawRenderer::flush(const std::shared_ptr<Camera>& camera) {
+    if (gpuCulling) {
+        drawCulled(camera);
+    } else {
+        drawQueued(camera);
+    }
+}
+
+void MultiDrawRenderer::bindCamera(const std::shared_ptr<Camera>& camera) {
+    const CameraBlock block = {
+        camera->viewMatrix(),
+        camera->projectionMatrix(),
+        glm::vec4(camera->position(), 1.f)
+    };
+
+    const auto allocation = m_ring->write(&block, 1, m_uniformAlignment);
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BINDING, m_ring->buffer(), allocation.offset, sizeof(CameraBlock));
+}
+
+const std::shared_ptr<ShaderProgram>& MultiDrawRenderer::activeShader() const {
+    // g-buffer variant shares attribute locations and buffer bindings with the main program
+    return DeferredRenderer::active() != nullptr && m_shader->gBufferVariant() != nullptr
+        ? m_shader->gBufferVariant()
+        : m_shader;
+}
+
+void MultiDrawRenderer::drawQueued(const std::shared_ptr<Camera>& camera) {
+    if (m_commands.empty()) {
+        return;
+    }
+
+    const auto drawData = m_ring->write(m_drawData.data(), m_drawData.size(), m_storageAlignment);
+    const auto commands = m_ring->write(m_commands.data(), m_commands.size(), alignof(DrawCommand));
+
+    glBindBufferRange(
+        GL_SHADER_STORAGE_BUFFER, 0, m_ring->buffer(), drawData.offset,
+        static_cast<long>(m_drawData.size() * sizeof(DrawData))
+    );
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_ring->buffer());
+
+    activeShader()->use(camera);
+    bindCamera(camera);
+
+    glBindVertexArray(Engine::get()->meshManager()->geometryBuffer()->VAO());
+    glMultiDrawElementsIndirect(
+        GL_TRIANGLES, GL_UNSIGNED_INT,
+        reinterpret_cast<const void*>(commands.offset),
+        static_cast<int>(m_commands.size()), 0
+    );
+    glBindVertexArray(0);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    m_commands.clear();
+    m_drawData.clear();
+}
+
+void MultiDrawRenderer::drawCulled(const std::shared_ptr<Camera>& camera) {
+    updateInstances();
+
+    if (m_instanceCount == 0) {
+        return;
+    }
+
+    constexpr unsigned int zero = 0;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawCountBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+#ifdef GL_ARB_indirect_parameters
+    const bool hasDrawCount = GLAD_GL_ARB_indirect_parameters;
+#else
+    constexpr bool hasDrawCount = false;
+#endif
+
+    // without the draw count from the GPU all commands are drawn, culled ones must have zero instances
+    if (!hasDrawCount) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_culledCommandBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_culledCommandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_drawCountBuffer);
+
+    const Frustum frustum(camera->cullingMatrix());
+
+    CullParams params{};
+    std::ranges::copy(frustum.planes(), params.frustumPlanes);
+    params.instanceCount = m_instanceCount;
+
+    const auto paramsAllocation = m_ring->write(&params, 1, m_uniformAlignment);
+    glBindBufferRange(GL_UNIFORM_BUFFER, CULL_PARAMS_BINDING, m_ring->buffer(), paramsAllocation.offset, sizeof(CullParams));
+
+    m_cullShader->use();
+
+    glDispatchCompute((m_instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceDrawDataBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_culledCommandBuffer);
+
+    activeShader()->use(camera);
+    bindCamera(camera);
+
+    glBindVertexArray(Engine::get()->meshManager()->geometryBuffer()->VAO());
+
+#ifdef GL_ARB_indirect_parameters
+    if (hasDrawCount) {
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, m_drawCountBuffer);
+        glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, static_cast<int>(m_instanceCount), 0);
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+    }
+#endif
+
+    if (!hasDrawCount) {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<int>(m_instanceCount), 0);
+    }
+
+    glBindVertexArray(0);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void MultiDrawRenderer::updateInstances() {
+    const uint64_t frameIndex = Engine::get()->window()->input()->frameIndex();
+
+    if (m_instancesCheckFrameIndex == frameIndex) {
+        return;
+    }
+
+    m_instancesCheckFrameIndex = frameIndex;
+
+    std::erase_if(m_entries, [](const auto& entry) { return entry.second.mesh.expired(); });
+
+    for (const auto& [key, entry] : m_entries) {
+        const auto mesh = entry.mesh.lock();
+
+        if (entry.transformVersion != mesh->transform()->version() || entry.visible != mesh->node()->visible) {
+            m_instancesChanged = true;
+            break;
+        }
+    }
+
+    if (!m_instancesChanged) {
+        return;
+    }
+
+    m_instancesChanged = false;
+
+    std::vector<CullInstance> instances;
+    std::vector<DrawData> drawData;
+
+    instances.reserve(m_entries.size());
+    drawData.reserve(m_entries.size());
+
+    for (auto& [key, entry] : m_entries) {
+        const auto mesh = entry.mesh.lock();
+        entry.transformVersion = mesh->transform()->version();
+        entry.visible = mesh->node()->visible;
+
+        if (!entry.visible || instances.size() == GeometryBuffer::MAX_DRAWS) {
+            continue;
+        }
+
+        const AABB& aabb = mesh->worldAABB();
+
+        instances.push_back({
+            glm::vec4(aabb.min, 1.f),
+            glm::vec4(aabb.max, 1.f),
+            entry.range.indexCount,
+            entry.range.firstIndex,
+            entry.range.baseVertex,
+            0
+        });
+
+        drawData.push_back({ mesh->transform()->transformMatrix(), glm::vec4(entry.color, 1.f) });
+    }
+
+    m_instanceCount = static_cast<unsigned int>(instances.size());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(CullInstance), instances.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceDrawDataBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, drawData.size() * sizeof(DrawData), drawData.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+#else
+
+MultiDrawRenderer::MultiDrawRenderer() {
+    throw std::runtime_error("MULTI DRAW RENDERER. OpenGL 4.3 with buffer storage is not supported");
+}
+
+MultiDrawRenderer::~MultiDrawRenderer() = default;
+
+void MultiDrawRenderer::add(const std::shared_ptr<MeshComponent>&, const glm::vec3&) {}
+void MultiDrawRenderer::remove(const std::shared_ptr<MeshComponent>&) {}
+bool MultiDrawRenderer::submit(const std::shared_ptr<MeshComponent>&) { return false; }
+void MultiDrawRenderer::flush(const std::shared_ptr<Camera>&) {}
+
+#endif
+
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "geometry_buffer.h"
+#include "ring_buffer.h"
+
+namespace SimpleGL {
+
+class Camera;
+class MeshComponent;
+class ShaderProgram;
+
+/// Draws registered meshes with a single glMultiDrawElementsIndirect per pass.
+/// Geometry comes from the shared GeometryBuffer, per-draw transform and color from a shader storage buffer indexed by
+/// the draw id attribute. Meshes are shaded like the untextured lit shader, with forward lighting or, while a deferred
+/// renderer is active, into its g-buffer. Requires OpenGL 4.3.
+/// With gpuCulling, all registered meshes are drawn by flush: bounds uploaded once are frustum tested by a compute shader,
+/// which compacts survivors into the indirect command buffer, so a view costs a few API calls regardless of mesh count.
+/// Per-pass data (draw commands, draw data, camera and culling parameters) is written into a persistently mapped RingBuffer
+/// and bound by offset, so the hot path makes no buffer uploads and no uniform calls. Also requires buffer storage.
+class MultiDrawRenderer {
+public:
+    /// Culling of registered meshes runs on the GPU, meshes queued by submit are ignored
+    bool gpuCulling = false;
+
+    static bool isSupported();
+
+    MultiDrawRenderer();
+    ~MultiDrawRenderer();
+
+    MultiDrawRenderer(const MultiDrawRenderer&) = delete;
+    MultiDrawRenderer& operator=(const MultiDrawRenderer&) = delete;
+
+    /// mesh is drawn by this renderer with color instead of its own shader
+    void add(const std::shared_ptr<MeshComponent>& mesh, const glm::vec3& color);
+    void remove(const std::shared_ptr<MeshComponent>& mesh);
+
+    /// Queues mesh for the next flush. Returns false if the mesh is not registered, then it must be drawn as usual
+    bool submit(const std::shared_ptr<MeshComponent>& mesh);
+
+    /// Draws all queued meshes with one call, or all registered meshes visible to camera with gpuCulling
+    void flush(const std::shared_ptr<Camera>& camera);
+
+private:
+    /// Same layout as DrawElementsIndirectCommand in the OpenGL specification
+    struct DrawCommand {
+        unsigned int count;
+        unsigned int instanceCount;
+        unsigned int firstIndex;
+        int baseVertex;
+        unsigned int baseInstance;
+    };
+
+    /// std430 layout of DrawData in the vertex shader
+    struct DrawData {
+        glm::mat4 transform;
+        glm::vec4 color;
+    };
+
+    /// std140 layout of CameraBlock in the shaders
+    struct CameraBlock {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 viewPosition;
+    };
+
+    /// std140 layout of CullParams in the culling compute shader
+    struct CullParams {
+        glm::vec4 frustumPlanes[6];
+        unsigned int instanceCount;
+    };
+
+    /// std430 layout of Instance in the culling compute shader
+    struct CullInstance {
+        glm::vec4 aabbMin;
+        glm::vec4 aabbMax;
+        unsigned int indexCount;
+        unsigned int firstIndex;
+        int baseVertex;
+        unsigned int padding;
+    };
+
+    struct Entry {
+        std::weak_ptr<MeshComponent> mesh;
+        GeometryBuffer::Range range;
+        glm::vec3 color;
+        /// Transform version and visibility of the uploaded instance data
+        uint64_t transformVersion = -1;
+        bool visible = false;
+    };
+
+    /// Must match local_size_x of the culling compute shader
+    static constexpr unsigned int CULL_GROUP_SIZE = 64;
+
+    /// Uniform block bindings, must match the shaders
+    static constexpr unsigned int CAMERA_BINDING = 0;
+    static constexpr unsigned int CULL_PARAMS_BINDING = 1;
+
+    /// Ring buffer bytes per frame, enough for MAX_DRAWS queued draws in about 20 passes
+    static constexpr long RING_FRAME_SIZE = 8 * 1024 * 1024;
+
+    std::unordered_map<const MeshComponent*, Entry> m_entries;
+
+    std::shared_ptr<ShaderProgram> m_shader;
+
+    std::vector<DrawCommand> m_commands;
+    std::vector<DrawData> m_drawData;
+
+    std::unique_ptr<RingBuffer> m_ring;
+    long m_uniformAlignment = 0;
+    long m_storageAlignment = 0;
+
+    std::shared_ptr<ShaderProgram> m_cullShader;
+
+    unsigned int m_instanceBuffer = 0;
+    unsigned int m_instanceDrawDataBuffer = 0;
+    unsigned int m_culledCommandBuffer = 0;
+    unsigned int m_drawCountBuffer = 0;
+
+    unsigned int m_instanceCount = 0;
+    bool m_instancesChanged = true;
+    uint64_t m_instancesCheckFrameIndex = -1;
+
+    /// Uploads bounds and draw data of registered meshes if they changed. Checks once per frame
+    void updateInstances();
+
+    /// G-buffer variant of the shader while a deferred renderer is active, the forward one otherwise
+    const std::shared_ptr<ShaderProgram>& activeShader() const;
+
+    /// Writes view data of camera into the ring and binds it to CAMERA_BINDING
+    void bindCamera(const std::shared_ptr<Camera>& camera);
+
+    void drawQueued(const std::shared_ptr<Camera>& camera);
+    void drawCulled(const std::shared_ptr<Camera>& camera);
+};
+
+}
@@ -0,0 +1,113 @@
+#include "ring_buffer.h"
+
+#include <format>
+#include <stdexcept>
+
+#include "../../managers/engine.h"
+#include "../../window/input.h"
+#include "../../window/window.h"
+
+namespace SimpleGL {
+
+bool RingBuffer::isSupported() {
+#ifdef GL_VERSION_4_4
+    return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+#else
+    return false;
+#endif
+}
+
+RingBuffer::RingBuffer(long frameSize): m_frameSize(frameSize) {
+#ifdef GL_VERSION_4_4
+    if (!isSupported()) {
+        throw std::runtime_error("RING BUFFER. Buffer storage is not supported");
+    }
+
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const long size = m_frameSize * FRAMES;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+
+    m_mappedData = static_cast<char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (m_mappedData == nullptr) {
+        throw std::runtime_error("RING BUFFER. glMapBufferRange failed");
+    }
+#else
+    throw std::runtime_error("RING BUFFER. Buffer storage is not supported");
+#endif
+}
+
+RingBuffer::~RingBuffer() {
+    for (const auto fence : m_fences) {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+        }
+    }
+
+    if (m_buffer != 0) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+RingBuffer::Allocation RingBuffer::allocate(long size, long alignment) {
+    const uint64_t frameIndex = Engine::get()->window()->input()->frameIndex();
+
+    if (frameIndex != m_frameIndex) {
+        m_frameIndex = frameIndex;
+        nextRegion();
+    }
+
+    const long offset = (m_regionOffset + alignment - 1) & ~(alignment - 1);
+
+    if (offset + size > m_frameSize) {
+        throw std::runtime_error(std::format(
+            "RING BUFFER. Frame region is full. Frame size: {}, requested: {}",
+            m_frameSize, offset + size
+        ));
+    }
+
+    m_regionOffset = offset + size;
+
+    const long bufferOffset = m_region * m_frameSize + offset;
+
+    return { m_mappedData + bufferOffset, bufferOffset };
+}
+
+void RingBuffer::nextRegion() {
+    // commands of the frame that used the current region are all submitted by now
+    if (m_fences[m_region] != nullptr) {
+        glDeleteSync(m_fences[m_region]);
+    }
+
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_region = (m_region + 1) % FRAMES;
+    m_regionOffset = 0;
+
+    GLsync& fence = m_fences[m_region];
+
+    if (fence == nullptr) {
+        return;
+    }
+
+    constexpr GLuint64 timeout = 1'000'000;
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+    while (result == GL_TIMEOUT_EXPIRED) {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+}
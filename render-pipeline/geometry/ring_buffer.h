@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include <glad/glad.h>
+
+namespace SimpleGL {
+
+/// Persistently mapped buffer split into FRAMES regions, used round-robin one per frame.
+/// The CPU writes dynamic data straight into mapped memory and shaders read it by offset, so no data is uploaded by calls.
+/// When a new frame starts, a fence is placed after the previous frame's commands; a region is reused only after
+/// its fence from FRAMES frames ago has signaled, which normally happened long before. Requires OpenGL 4.4 or ARB_buffer_storage.
+class RingBuffer {
+public:
+    static constexpr int FRAMES = 3;
+
+    struct Allocation {
+        void* data = nullptr;
+        /// Offset from the start of the buffer, for glBindBufferRange or indirect draws
+        long offset = 0;
+    };
+
+    static bool isSupported();
+
+    /// frameSize is the number of bytes one frame may write
+    explicit RingBuffer(long frameSize);
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    /// alignment must be a power of two. The first allocation of a frame switches to the next region
+    Allocation allocate(long size, long alignment);
+
+    template<typename T>
+    Allocation write(const T* data, size_t count, long alignment) {
+        const Allocation allocation = allocate(static_cast<long>(count * sizeof(T)), alignment);
+        std::memcpy(allocation.data, data, count * sizeof(T));
+
+        return allocation;
+    }
+
+    unsigned int buffer() const { return m_buffer; }
+
+private:
+    unsigned int m_buffer = 0;
+    char* m_mappedData = nullptr;
+
+    long m_frameSize = 0;
+    int m_region = 0;
+    long m_regionOffset = 0;
+    uint64_t m_frameIndex = -1;
+
+    std::array<GLsync, FRAMES> m_fences{};
+
+    void nextRegion();
+};
+
+}
@@ -0,0 +1,163 @@
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+
+namespace SimpleGL {
+
+const VertexFormat& VertexFormat::create(
+    std::string name,
+    std::vector<int> strides,
+    std::vector<VertexAttribute> attributes,
+    bool octahedralNormals
+) {
+    // deque keeps references valid when formats are added
+    static std::deque<VertexFormat> formats;
+
+    const auto id = static_cast<unsigned int>(formats.size());
+
+    return formats.emplace_back(id, std::move(name), std::move(strides), std::move(attributes), octahedralNormals);
+}
+
+const VertexFormat& VertexFormat::standard() {
+    static const VertexFormat& format = create("standard", { 8 * sizeof(float) }, {
+        { POSITION_LOCATION, 3, GL_FLOAT, false, 0 },
+        { TEXTURE_COORD_LOCATION, 2, GL_FLOAT, false, 3 * sizeof(float) },
+        { NORMAL_LOCATION, 3, GL_FLOAT, false, 5 * sizeof(float) },
+    });
+
+    return format;
+}
+
+const VertexFormat& VertexFormat::standardPositions() {
+    static const VertexFormat& format = create("standardPositions", { 8 * sizeof(float) }, {
+        { POSITION_LOCATION, 3, GL_FLOAT, false, 0 },
+    });
+
+    return format;
+}
+
+const VertexFormat& VertexFormat::split() {
+    static const VertexFormat& format = create("split", { 3 * sizeof(float), 5 * sizeof(float) }, {
+        { POSITION_LOCATION, 3, GL_FLOAT, false, 0, 0 },
+        { TEXTURE_COORD_LOCATION, 2, GL_FLOAT, false, 0, 1 },
+        { NORMAL_LOCATION, 3, GL_FLOAT, false, 2 * sizeof(float), 1 },
+    });
+
+    return format;
+}
+
+const VertexFormat& VertexFormat::splitPositions() {
+    static const VertexFormat& format = create("splitPositions", { 3 * sizeof(float) }, {
+        { POSITION_LOCATION, 3, GL_FLOAT, false, 0, 0 },
+    });
+
+    return format;
+}
+
+const VertexFormat& VertexFormat::quantized() {
+    static const VertexFormat& format = create("quantized", { 16 }, {
+        { POSITION_LOCATION, 3, GL_UNSIGNED_SHORT, true, 0 },
+        { TEXTURE_COORD_LOCATION, 2, GL_HALF_FLOAT, false, 8 },
+        { NORMAL_LOCATION, 2, GL_SHORT, true, 12 },
+    }, true);
+
+    return format;
+}
+
+const VertexFormat& VertexFormat::quantizedPositions() {
+    static const VertexFormat& format = create("quantizedPositions", { 16 }, {
+        { POSITION_LOCATION, 3, GL_UNSIGNED_SHORT, true, 0 },
+    });
+
+    return format;
+}
+
+const VertexFormat& VertexFormat::quantizedSplit() {
+    static const VertexFormat& format = create("quantizedSplit", { 8, 8 }, {
+        { POSITION_LOCATION, 3, GL_UNSIGNED_SHORT, true, 0, 0 },
+        { TEXTURE_COORD_LOCATION, 2, GL_HALF_FLOAT, false, 0, 1 },
+        { NORMAL_LOCATION, 2, GL_SHORT, true, 4, 1 },
+    }, true);
+
+    return format;
+}
+
+const VertexFormat& VertexFormat::quantizedSplitPositions() {
+    static const VertexFormat& format = create("quantizedSplitPositions", { 8 }, {
+        { POSITION_LOCATION, 3, GL_UNSIGNED_SHORT, true, 0, 0 },
+    });
+
+    return format;
+}
+
+const VertexFormat& VertexFormat::mesh(VertexLayout layout, VertexPrecision precision, bool positionsOnly) {
+    if (precision == VertexPrecision::Quantized) {
+        if (layout == VertexLayout::Split) {
+            return positionsOnly ? quantizedSplitPositions() : quantizedSplit();
+        }
+
+        return positionsOnly ? quantizedPositions() : quantized();
+    }
+
+    if (layout == VertexLayout::Split) {
+        return positionsOnly ? splitPositions() : split();
+    }
+
+    return positionsOnly ? standardPositions() : standard();
+}
+
+const VertexFormat& VertexFormat::instanced(const VertexFormat& format) {
+    static std::unordered_map<unsigned int, const VertexFormat*> instancedFormats;
+
+    const auto [it, isNew] = instancedFormats.try_emplace(format.id);
+
+    if (!isNew) {
+        return *it->second;
+    }
+
+    auto strides = format.strides;
+    auto attributes = format.attributes;
+
+    const int stream = static_cast<int>(strides.size());
+    constexpr int columnSize = 4 * sizeof(float);
+
+    strides.push_back(4 * columnSize);
+
+    // one location per matrix column
+    for (int column = 0; column < 4; column++) {
+        attributes.push_back({ INSTANCE_TRANSFORM_LOCATION + column, 4, GL_FLOAT, false, column * columnSize, stream, 1 });
+    }
+
+    it->second = &create(format.name + "Instanced", std::move(strides), std::move(attributes), format.octahedralNormals);
+
+    return *it->second;
+}
+
+bool VertexFormat::hasLocation(int location) const {
+    return std::ranges::find(attributes, location, &VertexAttribute::location) != attributes.end();
+}
+
+void VertexFormat::apply(const std::vector<unsigned int>& buffers) const {
+    for (const auto& attribute : attributes) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffers.at(attribute.stream));
+
+        glVertexAttribPointer(
+            attribute.location,
+            attribute.size,
+            attribute.type,
+            attribute.normalized ? GL_TRUE : GL_FALSE,
+            strides[attribute.stream],
+            reinterpret_cast<void*>(static_cast<intptr_t>(attribute.offset))
+        );
+
+        if (attribute.divisor != 0) {
+            glVertexAttribDivisor(attribute.location, attribute.divisor);
+        }
+
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
+
+}
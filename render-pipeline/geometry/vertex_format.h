@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace SimpleGL {
+
+struct VertexAttribute {
+    int location;
+    int size;
+    GLenum type;
+    bool normalized = false;
+    /// Offset in bytes from the start of a vertex in its stream
+    int offset = 0;
+    /// Index of the vertex buffer the attribute is read from
+    int stream = 0;
+    /// Attribute advances once per this many instances, 0 for per-vertex attributes
+    int divisor = 0;
+};
+
+/// How mesh vertices are stored in vertex buffers
+enum class VertexLayout {
+    /// All attributes in one buffer
+    Interleaved,
+    /// Positions in their own tightly packed buffer, other attributes interleaved in a second one.
+    /// Depth and stencil passes read just the positions
+    Split,
+};
+
+/// How mesh vertex attributes are encoded in vertex buffers
+enum class VertexPrecision {
+    /// 32-bit floats, 32 bytes per vertex
+    Float,
+    /// Positions as 16-bit values normalized to the mesh bounds, texture coordinates as half floats,
+    /// normals octahedral encoded into two 16-bit values. 16 bytes per vertex.
+    /// Vertex shaders decode them with include/vertex-decoding.glsl
+    Quantized,
+};
+
+/// Layout of vertices in one or more vertex buffers, called streams. Formats are registered once and never destroyed,
+/// so they are compared and used as keys by id.
+/// Attribute locations are fixed for all formats, shaders declare mesh attributes with these explicit locations,
+/// so a VAO built for a format works with every shader and switching shaders needs no attribute rebinding.
+struct VertexFormat {
+    static constexpr int POSITION_LOCATION = 0;
+    static constexpr int TEXTURE_COORD_LOCATION = 1;
+    static constexpr int NORMAL_LOCATION = 2;
+    /// World matrix of an instance, a mat4 occupies 4 consecutive locations
+    static constexpr int INSTANCE_TRANSFORM_LOCATION = 4;
+
+    const unsigned int id;
+    const std::string name;
+    /// Size of a vertex in bytes in every stream
+    const std::vector<int> strides;
+    const std::vector<VertexAttribute> attributes;
+    /// Normal has two octahedral encoded components
+    const bool octahedralNormals;
+
+    /// Adds a format to the registry
+    static const VertexFormat& create(
+        std::string name,
+        std::vector<int> strides,
+        std::vector<VertexAttribute> attributes,
+        bool octahedralNormals = false
+    );
+
+    /// Position, texture coordinates and normal as interleaved floats, the layout of MeshData vertices
+    static const VertexFormat& standard();
+
+    /// Position only, read from standard vertices
+    static const VertexFormat& standardPositions();
+
+    /// Position in the first stream, texture coordinates and normal in the second one
+    static const VertexFormat& split();
+
+    /// Position only, read from the first stream of split vertices
+    static const VertexFormat& splitPositions();
+
+    /// Interleaved quantized position, texture coordinates and normal, see VertexPrecision::Quantized.
+    /// Position is padded to 8 bytes, so all attributes are 4-byte aligned
+    static const VertexFormat& quantized();
+
+    /// Position only, read from quantized vertices
+    static const VertexFormat& quantizedPositions();
+
+    /// Quantized position in the first stream, texture coordinates and normal in the second one
+    static const VertexFormat& quantizedSplit();
+
+    /// Position only, read from the first stream of quantized split vertices
+    static const VertexFormat& quantizedSplitPositions();
+
+    /// Format of mesh vertices with all attributes, or positions only
+    static const VertexFormat& mesh(VertexLayout layout, VertexPrecision precision, bool positionsOnly = false);
+
+    /// Attributes of format plus the instance world matrix, read from one more stream of tightly packed matrices
+    static const VertexFormat& instanced(const VertexFormat& format);
+
+    bool hasLocation(int location) const;
+
+    /// Specifies and enables attributes of the bound VAO, reading stream i from buffers[i].
+    /// GL_ARRAY_BUFFER is left bound to one of the buffers
+    void apply(const std::vector<unsigned int>& buffers) const;
+};
+
+}
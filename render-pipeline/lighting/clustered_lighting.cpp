@@ -0,0 +1,335 @@
+#include "clustered_lighting.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glad/glad.h>
+
+#include "../../managers/engine.h"
+#include "../../managers/job_manager.h"
+#include "../../managers/shader_manager.h"
+#include "../../entities/scene.h"
+#include "../../entities/shader_program.h"
+#include "../../entities/components/camera.h"
+#include "../../entities/components/light.h"
+#include "../../entities/components/transform.h"
+#include "../../window/window.h"
+#include "../../window/input.h"
+
+namespace SimpleGL {
+
+ClusteredLighting::ClusteredLighting() {
+    createBufferTexture(GL_RGBA32F, m_lightsBuffer, m_lightsTexture);
+    createBufferTexture(GL_RG32UI, m_gridBuffer, m_gridTexture);
+    createBufferTexture(GL_R16UI, m_indicesBuffer, m_indicesTexture);
+
+    m_sliceIndices.resize(GRID_Z);
+    m_grid.resize(CLUSTERS_COUNT);
+}
+
+ClusteredLighting::~ClusteredLighting() {
+    glDeleteTextures(1, &m_lightsTexture);
+    glDeleteTextures(1, &m_gridTexture);
+    glDeleteTextures(1, &m_indicesTexture);
+    glDeleteTextures(1, &m_computeIndicesTexture);
+    glDeleteBuffers(1, &m_lightsBuffer);
+    glDeleteBuffers(1, &m_gridBuffer);
+    glDeleteBuffers(1, &m_indicesBuffer);
+    glDeleteBuffers(1, &m_computeIndicesBuffer);
+}
+
+void ClusteredLighting::update(const std::shared_ptr<Camera>& camera) {
+    const uint64_t frameIndex = Engine::get()->window()->input()->frameIndex();
+
+    if (frameIndex != m_lightsFrameIndex) {
+        updateLights(frameIndex);
+    }
+
+    const bool isBuilt = frameIndex == m_clustersFrameIndex
+        && camera->viewMatrix() == m_clustersViewMatrix
+        && camera->projectionMatrix() == m_clustersProjectionMatrix;
+
+    if (!isBuilt) {
+        buildClusters(camera);
+
+        m_clustersFrameIndex = frameIndex;
+        m_clustersViewMatrix = camera->viewMatrix();
+        m_clustersProjectionMatrix = camera->projectionMatrix();
+    }
+}
+
+void ClusteredLighting::bind(ShaderProgram& shaderProgram, const std::shared_ptr<Camera>& camera) {
+    update(camera);
+
+    shaderProgram.setTexture("clusterLights", m_lightsTexture, 0, GL_TEXTURE_BUFFER);
+    shaderProgram.setTexture("clusterGrid", m_gridTexture, 0, GL_TEXTURE_BUFFER);
+    shaderProgram.setTexture("clusterLightIndices", m_isComputeAssigned ? m_computeIndicesTexture : m_indicesTexture, 0, GL_TEXTURE_BUFFER);
+    shaderProgram.setUniform("clusterParams", m_clusterParams);
+}
+
+void ClusteredLighting::updateLights(uint64_t frameIndex) {
+    const auto& pointLights = Engine::get()->scene()->pointLights();
+    const size_t lightsCount = std::min<size_t>(pointLights.size(), MAX_POINT_LIGHTS);
+
+    std::vector<glm::vec4> texels;
+    texels.reserve(std::max<size_t>(lightsCount * LIGHT_TEXELS, 1));
+
+    m_lightX.clear();
+    m_lightY.clear();
+    m_lightZ.clear();
+    m_lightRadius.clear();
+
+    for (size_t i = 0; i < lightsCount; i++) {
+        const auto light = pointLights[i].lock();
+        const auto position = light->transform()->absolutePosition();
+
+        texels.emplace_back(position, light->distance);
+        texels.emplace_back(light->ambient, 0.f);
+        texels.emplace_back(light->diffuse, 0.f);
+        texels.emplace_back(light->specular, 0.f);
+
+        m_lightX.push_back(position.x);
+        m_lightY.push_back(position.y);
+        m_lightZ.push_back(position.z);
+        m_lightRadius.push_back(light->distance);
+    }
+
+    if (texels.empty()) {
+        texels.emplace_back(0.f);
+    }
+
+    uploadBuffer(m_lightsBuffer, texels.data(), texels.size() * sizeof(glm::vec4));
+
+    m_lightsCount = lightsCount;
+
+    m_lightsFrameIndex = frameIndex;
+}
+
+void ClusteredLighting::buildClusters(const std::shared_ptr<Camera>& camera) {
+    const float near = camera->near();
+    const float far = camera->far();
+    const float scaleX = camera->projectionMatrix()[0][0];
+    const float scaleY = camera->projectionMatrix()[1][1];
+
+    m_clusterParams = glm::vec4(near, GRID_Z / std::log(far / near), scaleX, scaleY);
+
+    m_isComputeAssigned = isComputeAssignmentSupported();
+
+    if (m_isComputeAssigned) {
+        assignLightsCompute(camera->viewMatrix());
+        return;
+    }
+
+    computeLightRanges(camera->viewMatrix(), near, far, scaleX, scaleY);
+
+    Engine::get()->jobManager()->parallelFor(GRID_Z, 1, [this](unsigned int begin, unsigned int end) {
+        for (unsigned int slice = begin; slice < end; slice++) {
+            assignSlice(slice);
+        }
+    });
+
+    // concatenate per-slice lists
+    m_indices.clear();
+
+    for (unsigned int slice = 0; slice < GRID_Z; slice++) {
+        const auto base = static_cast<unsigned int>(m_indices.size());
+        const unsigned int firstCluster = slice * GRID_X * GRID_Y;
+
+        for (unsigned int i = firstCluster; i < firstCluster + GRID_X * GRID_Y; i++) {
+            m_grid[i].x += base;
+        }
+
+        m_indices.insert(m_indices.end(), m_sliceIndices[slice].begin(), m_sliceIndices[slice].end());
+    }
+
+    if (m_indices.empty()) {
+        m_indices.push_back(0);
+    }
+
+    uploadBuffer(m_gridBuffer, m_grid.data(), m_grid.size() * sizeof(glm::uvec2));
+    uploadBuffer(m_indicesBuffer, m_indices.data(), m_indices.size() * sizeof(uint16_t));
+}
+
+bool ClusteredLighting::isComputeAssignmentSupported() const {
+#ifdef GL_VERSION_4_3
+    return computeAssignment && GLAD_GL_VERSION_4_3;
+#else
+    return false;
+#endif
+}
+
+void ClusteredLighting::assignLightsCompute(const glm::mat4& view) {
+#ifdef GL_VERSION_4_3
+    if (m_assignShader == nullptr) {
+        m_assignShader = Engine::get()->shaderManager()->createComputeProgram(
+            "shaders/clustered-lighting/assign-compute.glsl",
+            "clustered lighting assign compute program"
+        );
+
+        createBufferTexture(GL_R32UI, m_computeIndicesBuffer, m_computeIndicesTexture);
+        uploadBuffer(m_computeIndicesBuffer, nullptr, CLUSTERS_COUNT * MAX_CLUSTER_LIGHTS * sizeof(unsigned int));
+
+        // grid is written by the shader, so it is allocated once at its full size
+        uploadBuffer(m_gridBuffer, nullptr, CLUSTERS_COUNT * sizeof(glm::uvec2));
+    }
+
+    m_assignShader->use();
+    m_assignShader->setUniform("view", view);
+    m_assignShader->setUniform("clusterParams", m_clusterParams);
+    m_assignShader->setUniform("lightsCount", static_cast<int>(m_lightsCount));
+    m_assignShader->setUniform("maxClusterLights", static_cast<int>(MAX_CLUSTER_LIGHTS));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_lightsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_gridBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_computeIndicesBuffer);
+
+    glDispatchCompute(1, 1, GRID_Z);
+
+    // shaders read the results through buffer textures
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+#endif
+}
+
+void ClusteredLighting::computeLightRanges(const glm::mat4& view, float near, float far, float scaleX, float scaleY) {
+    const size_t lightsCount = m_lightX.size();
+
+    m_viewX.resize(lightsCount);
+    m_viewY.resize(lightsCount);
+    m_viewDepth.resize(lightsCount);
+    m_lightRanges.resize(lightsCount);
+    m_visibleLights.clear();
+
+    // branchless loop over structure of arrays, so the compiler can vectorize it
+    for (size_t i = 0; i < lightsCount; i++) {
+        const float x = m_lightX[i];
+        const float y = m_lightY[i];
+        const float z = m_lightZ[i];
+
+        m_viewX[i] = view[0][0] * x + view[1][0] * y + view[2][0] * z + view[3][0];
+        m_viewY[i] = view[0][1] * x + view[1][1] * y + view[2][1] * z + view[3][1];
+        m_viewDepth[i] = -(view[0][2] * x + view[1][2] * y + view[2][2] * z + view[3][2]);
+    }
+
+    const float sliceScale = m_clusterParams.y;
+
+    const auto getSlice = [near, sliceScale](float depth) {
+        const float slice = std::log(std::max(depth, near) / near) * sliceScale;
+        return static_cast<int>(std::clamp(slice, 0.f, static_cast<float>(GRID_Z - 1)));
+    };
+
+    // returns false if the range is outside the screen
+    const auto getTileRange = [](
+        float center, float radius, float minDepth, float maxDepth, float scale, unsigned int gridSize,
+        uint8_t& tileMin, uint8_t& tileMax
+    ) {
+        const float ndcMin = scale * std::min((center - radius) / minDepth, (center - radius) / maxDepth);
+        const float ndcMax = scale * std::max((center + radius) / minDepth, (center + radius) / maxDepth);
+
+        if (ndcMax < -1.f || ndcMin > 1.f) {
+            return false;
+        }
+
+        const float last = static_cast<float>(gridSize - 1);
+        tileMin = static_cast<uint8_t>(std::clamp(std::floor((ndcMin * 0.5f + 0.5f) * gridSize), 0.f, last));
+        tileMax = static_cast<uint8_t>(std::clamp(std::floor((ndcMax * 0.5f + 0.5f) * gridSize), 0.f, last));
+
+        return true;
+    };
+
+    for (unsigned int i = 0; i < lightsCount; i++) {
+        const float radius = m_lightRadius[i];
+        const float minDepth = m_viewDepth[i] - radius;
+        const float maxDepth = m_viewDepth[i] + radius;
+
+        if (maxDepth < near || minDepth > far) {
+            continue;
+        }
+
+        auto& range = m_lightRanges[i];
+
+        if (minDepth <= near) {
+            // the sphere crosses the near plane, its projection is unbounded
+            range = { 0, GRID_X - 1, 0, GRID_Y - 1, 0, 0 };
+        }
+        else {
+            const bool isOnScreen =
+                getTileRange(m_viewX[i], radius, minDepth, maxDepth, scaleX, GRID_X, range[0], range[1]) &&
+                getTileRange(m_viewY[i], radius, minDepth, maxDepth, scaleY, GRID_Y, range[2], range[3]);
+
+            if (!isOnScreen) {
+                continue;
+            }
+        }
+
+        range[4] = static_cast<uint8_t>(getSlice(minDepth));
+        range[5] = static_cast<uint8_t>(getSlice(maxDepth));
+
+        m_visibleLights.push_back(i);
+    }
+}
+
+void ClusteredLighting::assignSlice(unsigned int slice) {
+    constexpr unsigned int sliceClustersCount = GRID_X * GRID_Y;
+
+    std::array<unsigned int, sliceClustersCount> counts{};
+
+    const auto forEachCluster = [this, slice](const auto& callback) {
+        for (const unsigned int lightIndex : m_visibleLights) {
+            const auto& range = m_lightRanges[lightIndex];
+
+            if (slice < range[4] || slice > range[5]) {
+                continue;
+            }
+
+            for (unsigned int y = range[2]; y <= range[3]; y++) {
+                for (unsigned int x = range[0]; x <= range[1]; x++) {
+                    callback(x + y * GRID_X, lightIndex);
+                }
+            }
+        }
+    };
+
+    forEachCluster([&counts](unsigned int cluster, unsigned int) {
+        counts[cluster] += 1;
+    });
+
+    // offsets are local to the slice; buildClusters shifts them after concatenation
+    const unsigned int firstCluster = slice * sliceClustersCount;
+    unsigned int offset = 0;
+
+    for (unsigned int i = 0; i < sliceClustersCount; i++) {
+        m_grid[firstCluster + i] = glm::uvec2(offset, 0);
+        offset += counts[i];
+    }
+
+    auto& indices = m_sliceIndices[slice];
+    indices.resize(offset);
+
+    forEachCluster([this, &indices, firstCluster](unsigned int cluster, unsigned int lightIndex) {
+        auto& entry = m_grid[firstCluster + cluster];
+        indices[entry.x + entry.y] = static_cast<uint16_t>(lightIndex);
+        entry.y += 1;
+    });
+}
+
+void ClusteredLighting::createBufferTexture(unsigned int internalFormat, unsigned int& buffer, unsigned int& texture) {
+    glGenBuffers(1, &buffer);
+    glGenTextures(1, &texture);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLighting::uploadBuffer(unsigned int buffer, const void* data, size_t size) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(size), data, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+}
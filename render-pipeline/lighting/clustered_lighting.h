@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace SimpleGL {
+
+class Camera;
+class ShaderProgram;
+
+/// Clustered forward lighting.
+/// View frustum is divided into froxels (screen tiles x exponential depth slices),
+/// point lights are assigned to froxels and shaders iterate only the lights of their froxel.
+/// With OpenGL 4.3 lights are assigned by a compute shader, one invocation per froxel testing every light against its bounds,
+/// with a fixed range of MAX_CLUSTER_LIGHTS indices per froxel. Otherwise they are assigned on the CPU in parallel.
+/// Light data, froxel ranges and light indices are passed to shaders through buffer textures.
+class ClusteredLighting {
+public:
+    /// Must match CLUSTER_GRID_* defines in the lit shaders
+    static constexpr unsigned int GRID_X = 16;
+    static constexpr unsigned int GRID_Y = 9;
+    static constexpr unsigned int GRID_Z = 24;
+    static constexpr unsigned int CLUSTERS_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+    /// Light indices are stored as 16-bit values
+    static constexpr unsigned int MAX_POINT_LIGHTS = 0xFFFF;
+
+    /// Lights of a froxel above this count are dropped by the compute assignment
+    static constexpr unsigned int MAX_CLUSTER_LIGHTS = 128;
+
+    /// Assign lights with the compute shader when it is supported
+    bool computeAssignment = true;
+
+    ClusteredLighting();
+    ~ClusteredLighting();
+
+    /// Builds clusters for the camera, if they are not built yet in this frame.
+    /// May switch the current program, so it is called before the program using the clusters is made current
+    void update(const std::shared_ptr<Camera>& camera);
+
+    /// Updates clusters for the camera and binds them to the shader
+    void bind(ShaderProgram& shaderProgram, const std::shared_ptr<Camera>& camera);
+
+private:
+    /// Number of texels describing one light in lights buffer texture
+    static constexpr unsigned int LIGHT_TEXELS = 4;
+
+    unsigned int m_lightsBuffer = 0;
+    unsigned int m_lightsTexture = 0;
+    unsigned int m_gridBuffer = 0;
+    unsigned int m_gridTexture = 0;
+    unsigned int m_indicesBuffer = 0;
+    unsigned int m_indicesTexture = 0;
+
+    /// 32-bit indices written by the compute assignment, created on first use
+    unsigned int m_computeIndicesBuffer = 0;
+    unsigned int m_computeIndicesTexture = 0;
+    std::shared_ptr<ShaderProgram> m_assignShader;
+
+    /// Clusters of the current camera were assigned by the compute shader
+    bool m_isComputeAssigned = false;
+
+    size_t m_lightsCount = 0;
+
+    uint64_t m_lightsFrameIndex = -1;
+    uint64_t m_clustersFrameIndex = -1;
+    glm::mat4 m_clustersViewMatrix = glm::mat4(0);
+    glm::mat4 m_clustersProjectionMatrix = glm::mat4(0);
+
+    /// x - near plane, y - depth slices per log-depth unit, zw - projection scale
+    glm::vec4 m_clusterParams = glm::vec4(0);
+
+    /// World-space light spheres in structure of arrays layout
+    std::vector<float> m_lightX, m_lightY, m_lightZ, m_lightRadius;
+
+    /// View-space light centers of the current camera
+    std::vector<float> m_viewX, m_viewY, m_viewDepth;
+
+    /// Froxel range covered by each light, packed as [x0, x1, y0, y1, z0, z1]
+    std::vector<std::array<uint8_t, 6>> m_lightRanges;
+    std::vector<unsigned int> m_visibleLights;
+
+    /// Per-slice light lists, built in parallel and concatenated afterward
+    std::vector<std::vector<uint16_t>> m_sliceIndices;
+    std::vector<glm::uvec2> m_grid;
+    std::vector<uint16_t> m_indices;
+
+    void updateLights(uint64_t frameIndex);
+
+    void buildClusters(const std::shared_ptr<Camera>& camera);
+
+    bool isComputeAssignmentSupported() const;
+
+    void assignLightsCompute(const glm::mat4& view);
+
+    void computeLightRanges(const glm::mat4& view, float near, float far, float scaleX, float scaleY);
+
+    void assignSlice(unsigned int slice);
+
+    static void createBufferTexture(unsigned int internalFormat, unsigned int& buffer, unsigned int& texture);
+
+    static void uploadBuffer(unsigned int buffer, const void* data, size_t size);
+};
+
+}
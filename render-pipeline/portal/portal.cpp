@@ -2,9 +2,19 @@
 
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include "portal_framebuffer.h"
+#include "render_view.h"
+#include "../culling/frustum.h"
+#include "../culling/spatial_index.h"
+#include "../deferred/deferred_renderer.h"
+#include "../state/gl_state_cache.h"
 #include "../../managers/engine.h"
-#include "../../managers/shader_manager.h"
+#include "../../window/input.h"
+#include "../../window/window.h"
+#include "../../entities/mesh_data.h"
 #include "../../entities/node.h"
 #include "../../entities/scene.h"
 #include "../../entities/shader_program.h"
@@ -14,42 +24,35 @@
 
 namespace SimpleGL {
 
-Portal::Portal(const std::shared_ptr<Camera> &camera): m_camera(camera) {
-    m_tailPortalFramebuffer = std::make_shared<PortalFramebuffer>(1200 * 2, 900 * 2); // TODO
-
+Portal::Portal(
+    const std::shared_ptr<Camera>& camera,
+    const std::shared_ptr<Material>& portalMaterial,
+    const std::shared_ptr<ShaderProgram>& tailPortalShader,
+    const std::shared_ptr<ShaderProgram>& depthOnlyShader
+):
+    m_portalMaterial(portalMaterial),
+    m_tailPortalShader(tailPortalShader),
+    m_depthOnlyShader(depthOnlyShader),
+    m_camera(camera)
+{
     const auto rootNode = Engine::get()->scene()->rootNode();
 
     portal1Node = Node::create("portal1", rootNode);
     portal2Node = Node::create("portal2", rootNode);
-
-    createVirtualCameras();
-    createShaders();
-}
-
-std::shared_ptr<Portal> Portal::create(
-    const std::shared_ptr<Camera>& camera
-) {
-    auto instance = std::make_shared<Portal>(camera);
-    return instance;
 }
 
 void Portal::setPortalMesh(
     int portalIndex,
     const std::shared_ptr<MeshData> &meshData
 ) {
-    if (portalIndex != 1 && portalIndex != 2) {
-        throw std::runtime_error("Portal: incorrect portal index");
-    }
+    checkPortalIndex(portalIndex);
 
-    const auto portalNode = portalIndex == 1 ? portal1Node : portal2Node;
+    const auto portalNode = this->portalNode(portalIndex);
 
     const auto childNode = Node::create("childNode", portalNode);
     const auto mesh = MeshComponent::Factory::create(childNode, meshData, "portalMesh");
 
-    mesh->setShader(m_basicPortalShader);
-    mesh->setBeforeDrawCallback([](const std::shared_ptr<ShaderProgram>& shaderProgram) {
-        shaderProgram->setUniform("color", glm::vec3(0.3, 0.3, 0.3));
-    });
+    mesh->setMaterial(m_portalMaterial);
 
     const auto borderNode = Node::create("borderNode", childNode);
     const auto borderMesh = MeshComponent::Factory::create(borderNode, meshData, "portalBorderMesh");
@@ -58,177 +61,550 @@ void Portal::setPortalMesh(
     const auto tailMesh = MeshComponent::Factory::create(tailNode, meshData, "portalTailMesh");
 
     tailMesh->setShader(m_tailPortalShader);
-    tailMesh->setBeforeDrawCallback([&](const auto& shader) {
-        shader->setUniform("tailCameraView", m_tailVirtualCamera->viewMatrix());
-        shader->setUniform("tailCameraProjection", m_tailVirtualCamera->projectionMatrix());
+    tailMesh->setBeforeDrawCallback([this, portalIndex](const auto& shader) {
+        shader->setUniform("tailCameraView", m_tailCameraView);
+        shader->setUniform("tailCameraProjection", m_tailCameraProjection);
 
-        shader->setTexture("albedoTexture", m_tailPortalFramebuffer->colorTextureId());
+        shader->setTexture("albedoTexture", m_tailCaches[portalIndex - 1].framebuffer->colorTextureId());
     });
 }
 
+const std::shared_ptr<Node>& Portal::portalNode(int portalIndex) const {
+    checkPortalIndex(portalIndex);
+
+    return portalIndex == 1 ? portal1Node : portal2Node;
+}
+
+std::shared_ptr<MeshComponent> Portal::portalMesh(int portalIndex) const {
+    return portalNode(portalIndex)->getChild("childNode")->getComponent<MeshComponent>();
+}
+
+std::vector<RenderView> Portal::calculateRenderViews(int portalIndex, const glm::mat4& projection) const {
+    const auto& sourceT = portalNode(portalIndex)->transform();
+    const auto& destT = portalNode(3 - portalIndex)->transform();
+
+    const auto [qDelta, pDelta] = calculatePortalTransform(sourceT, destT);
+
+    // virtual cameras clip everything between them and the destination portal
+    const glm::vec3 planeNormal = destT->direction();
+    const glm::vec3 planePosition = destT->position();
+
+    std::vector<RenderView> result;
+    result.reserve(getTotalRecursionLevel() + 1);
+
+    RenderView cameraView;
+    cameraView.position = m_camera->position();
+    cameraView.orientation = m_camera->transform()->absoluteOrientation();
+    cameraView.viewMatrix = m_camera->viewMatrix();
+    cameraView.projectionMatrix = m_camera->projectionMatrix();
+    cameraView.frustum = Frustum(cameraView.projectionMatrix * cameraView.viewMatrix);
+
+    result.push_back(cameraView);
+
+    for (unsigned int i = 0; i < getTotalRecursionLevel(); i++) {
+        const RenderView& previous = result.back();
+
+        RenderView view;
+        view.position = pDelta + (qDelta * previous.position);
+        view.orientation = qDelta * previous.orientation;
+
+        view.viewMatrix = glm::mat4_cast(glm::conjugate(view.orientation));
+        view.viewMatrix = glm::translate(view.viewMatrix, -view.position);
+
+        view.projectionMatrix = Camera::obliqueProjection(
+            projection, view.viewMatrix, view.position, planeNormal, planePosition
+        );
+        view.frustum = Frustum(view.projectionMatrix * view.viewMatrix);
+
+        result.push_back(view);
+    }
+
+    return result;
+}
+
+std::vector<glm::vec4> Portal::screenRects(int portalIndex, const std::vector<RenderView>& renderViews) const {
+    const auto portalMesh = portalNode(portalIndex)->getChild("childNode")->getComponent<MeshComponent>();
+
+    return calculateScreenRects(portalMesh, renderViews, getTotalRecursionLevel());
+}
+
+bool Portal::prepareView(
+    View& view,
+    const std::vector<RenderView>& renderViews,
+    unsigned int levelsCount,
+    const std::vector<std::shared_ptr<Camera>>& virtualCameras
+) const {
+    const auto portalMesh = portalNode(view.portalIndex)->getChild("childNode")->getComponent<MeshComponent>();
+
+    view.recursiveCameras = applyRenderViews(renderViews, virtualCameras);
+    view.screenRects = calculateScreenRects(portalMesh, renderViews, levelsCount);
+
+    // the portal is off-screen or too small, the main pass draws its surface
+    if (isEmptyRect(view.screenRects[1])) {
+        return false;
+    }
+
+    // virtual cameras cull only what is visible through the portal. Tail levels sample
+    // the tail texture at their own screen position, which lies inside the rect of the first tail level
+    for (unsigned int i = 1; i <= m_maxRecursionLevel + 1 && i <= getTotalRecursionLevel(); i++) {
+        if (!isEmptyRect(view.screenRects[i])) {
+            view.recursiveCameras[i]->setScreenRect(view.screenRects[i]);
+        }
+    }
+
+    return true;
+}
+
+void Portal::finishView(const View& view) const {
+    for (unsigned int i = 1; i <= m_maxRecursionLevel + 1 && i <= getTotalRecursionLevel(); i++) {
+        view.recursiveCameras[i]->setScreenRect(FULL_SCREEN_RECT);
+    }
+}
+
+void Portal::drawStencil(const View& view, const glm::ivec4& viewport) const {
+    const auto portalMesh = portalNode(view.portalIndex)->getChild("childNode")->getComponent<MeshComponent>();
+
+    const auto& glState = Engine::get()->glState();
+
+    glState->setStencilOp(GL_KEEP, GL_KEEP, view.stencilDirection > 0 ? GL_INCR : GL_DECR);
+
+    for (int i=0; i < getTotalRecursionLevel(); i++) {
+        if (isEmptyRect(view.screenRects[i + 1])) {
+            break;
+        }
+
+        glState->setStencilFunc(GL_EQUAL, stencilValue(view, i));
+        applyScissor(view.screenRects[i], viewport);
+
+        portalMesh->drawPositions(view.recursiveCameras[i], m_depthOnlyShader);
+    }
+}
+
+void Portal::drawTail(
+    const View& view,
+    const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene
+) {
+    if (m_maxTailRecursionLevel == 0 || isEmptyRect(view.screenRects[m_maxRecursionLevel + 1])) {
+        return;
+    }
+
+    // the tail texture from previous frames is reused, unless something it depends on changed
+    auto& tailCache = m_tailCaches[view.portalIndex - 1];
+
+    // the cache key is in NDC, so a resize invalidates the texture here
+    updateTailFramebuffers(tailCache);
+
+    const auto key = createTailCacheKey(
+        portalNode(view.portalIndex),
+        portalNode(3 - view.portalIndex),
+        view.recursiveCameras[m_maxRecursionLevel + 1],
+        view.screenRects[m_maxRecursionLevel + 1]
+    );
+
+    if (isTailCacheOutdated(tailCache, key)) {
+        drawTailPortalToFramebuffer(tailCache, key, view.recursiveCameras, drawScene);
+    }
+}
+
+void Portal::drawLevel(
+    const View& view,
+    unsigned int level,
+    const glm::ivec4& viewport,
+    const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene
+) {
+    const unsigned int i = level;
+
+    if (isEmptyRect(view.screenRects[i - 1])) {
+        return;
+    }
+
+    const auto childNode = portalNode(view.portalIndex)->getChild("childNode");
+    const auto portalMesh = childNode->getComponent<MeshComponent>();
+    const auto portalBorderMesh = childNode->getChild("borderNode")->getComponent<MeshComponent>();
+    const auto portalTailMesh = childNode->getChild("tailNode")->getComponent<MeshComponent>();
+
+    const auto& recursiveCameras = view.recursiveCameras;
+    const auto& screenRects = view.screenRects;
+
+    const auto& glState = Engine::get()->glState();
+
+    // the border is drawn by the previous level, so it may be on the screen even if this level is not
+    const bool isVisible = !isEmptyRect(screenRects[i]);
+
+    glState->setColorMask(true);
+    applyLevelStencilFunc(view, i);
+    applyScissor(screenRects[i], viewport);
+
+    bool isTailPortal = i > m_maxRecursionLevel;
+
+    if (isVisible && isTailPortal) {
+        const auto& tailCache = m_tailCaches[view.portalIndex - 1];
+
+        m_tailCameraView = tailCache.viewMatrices[i - m_maxRecursionLevel - 1];
+        m_tailCameraProjection = tailCache.projectionMatrices[i - m_maxRecursionLevel - 1];
+
+        portalTailMesh->draw(recursiveCameras[i - 1]);
+    } else if (isVisible) {
+        drawScene(recursiveCameras[i]);
+    }
+
+    // draw portal border
+    glState->setStencilFunc(GL_EQUAL, stencilValue(view, i - 1));
+    applyScissor(screenRects[i - 1], viewport);
+
+    portalBorderMesh->draw(recursiveCameras[i - 1]);
+
+    // draw portal mesh to z-buffer
+    glState->setColorMask(false);
+    applyLevelStencilFunc(view, i);
+    glState->setDepthFunc(GL_ALWAYS);
+    applyScissor(screenRects[i], viewport);
+
+    if (isVisible) {
+        portalMesh->drawPositions(recursiveCameras[i - 1], m_depthOnlyShader);
+    }
+
+    glState->setDepthFunc(GL_LESS);
+}
+
 void Portal::drawPortal(
     int portalIndex,
+    const std::vector<RenderView>& renderViews,
+    unsigned int levelsCount,
+    const std::vector<std::shared_ptr<Camera>>& virtualCameras,
     const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene
 ) {
-    if (portalIndex != 1 && portalIndex != 2) {
-        throw std::runtime_error("Portal: incorrect portal index");
-    }
+    View view;
+    view.portalIndex = portalIndex;
 
-    const auto sourcePortalNode = portalIndex == 1 ? portal1Node : portal2Node;
-    const auto destPortalNode = portalIndex == 1 ? portal2Node : portal1Node;
+    if (!prepareView(view, renderViews, levelsCount, virtualCameras)) {
+        return;
+    }
 
-    const auto portalMesh = sourcePortalNode->getChild("childNode")->getComponent<MeshComponent>();
-    const auto portalBorderMesh =  sourcePortalNode->getChild("childNode")->getChild("borderNode")->getComponent<MeshComponent>();
-    const auto portalTailMesh =  sourcePortalNode->getChild("childNode")->getChild("tailNode")->getComponent<MeshComponent>();
+    glm::ivec4 viewport;
+    glGetIntegerv(GL_VIEWPORT, &viewport.x);
 
-    auto recursiveCameras = getRecursiveCameras(sourcePortalNode, destPortalNode);
+    const auto& glState = Engine::get()->glState();
 
     // prepare stencil buffer
-    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-
-    glDisable(GL_DEPTH_TEST);
-    glDepthMask(GL_FALSE);
+    glState->apply(stencilPassState());
+    glState->setEnabled(GL_SCISSOR_TEST, true);
 
-    glEnable(GL_STENCIL_TEST);
-    glStencilMask(0xFF);
-    glClearStencil(0);
+    glClearStencil(view.stencilBase);
+    applyScissor(view.screenRects[0], viewport);
     glClear(GL_STENCIL_BUFFER_BIT);
-    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
 
-    for (int i=0; i < getTotalRecursionLevel(); i++) {
-        glStencilFunc(GL_EQUAL, i, 0xFF);
+    drawStencil(view, viewport);
+
+    glState->setEnabled(GL_SCISSOR_TEST, false);
+
+    drawTail(view, drawScene);
+
+    // draw portal contents from deepest to shallowest
+    glState->apply(levelsPassState());
 
-        portalMesh->draw(recursiveCameras[i]);
+    for (unsigned int i = getTotalRecursionLevel(); i >= 1; i--) {
+        drawLevel(view, i, viewport, drawScene);
     }
 
-    // draw tail portal contents to tail FBO
-    if (m_maxTailRecursionLevel > 0) {
-        drawTailPortalToFramebuffer(drawScene);
+    glState->setEnabled(GL_SCISSOR_TEST, false);
+
+    finishView(view);
+}
+
+int Portal::stencilValue(const View& view, unsigned int level) {
+    return view.stencilBase + view.stencilDirection * static_cast<int>(level);
+}
+
+void Portal::applyLevelStencilFunc(const View& view, unsigned int level) {
+    // pixels of this level and deeper ones, values of levels grow away from the base
+    Engine::get()->glState()->setStencilFunc(view.stencilDirection > 0 ? GL_LEQUAL : GL_GEQUAL, stencilValue(view, level));
+}
+
+const PipelineState& Portal::stencilPassState() {
+    static constexpr PipelineState state = PipelineState::stencilOnly(GL_KEEP);
+
+    return state;
+}
+
+const PipelineState& Portal::levelsPassState() {
+    // color writes are switched by drawLevel
+    static constexpr PipelineState state = [] {
+        PipelineState result = PipelineState::opaque();
+        result.stencilTest = true;
+        result.colorWrite = false;
+        result.scissorTest = true;
+        return result;
+    }();
+
+    return state;
+}
+
+std::vector<glm::vec4> Portal::calculateScreenRects(
+    const std::shared_ptr<MeshComponent>& portalMesh,
+    const std::vector<RenderView>& renderViews,
+    unsigned int levelsCount
+) const {
+    std::vector<glm::vec4> result;
+    result.reserve(getTotalRecursionLevel() + 1);
+
+    result.push_back(FULL_SCREEN_RECT);
+
+    levelsCount = std::min(levelsCount, getTotalRecursionLevel());
+
+    // level i is visible through the portal seen by the camera of level i - 1, clipped by the rect of level i - 1
+    for (unsigned int i = 0; i < levelsCount; i++) {
+        const glm::vec4 portalRect = calculatePortalScreenRect(portalMesh, renderViews[i]);
+        const glm::vec4& previousRect = result.back();
+
+        const glm::vec4 rect = glm::vec4(
+            std::max(portalRect.x, previousRect.x),
+            std::max(portalRect.y, previousRect.y),
+            std::min(portalRect.z, previousRect.z),
+            std::min(portalRect.w, previousRect.w)
+        );
+
+        if (isEmptyRect(rect) || screenCoverage(rect) < minRecursionScreenArea) {
+            break;
+        }
+
+        result.push_back(rect);
     }
 
-    // draw portal contents from deepest to shallowest
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
+    // every level after an invisible one is invisible too
+    result.resize(getTotalRecursionLevel() + 1, EMPTY_RECT);
 
-    glEnable(GL_STENCIL_TEST);
-    glStencilMask(0x00);
-    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    return result;
+}
 
-    for (unsigned int i = getTotalRecursionLevel(); i >= 1; i--) {
-        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-        glStencilFunc(GL_LEQUAL, i, 0xFF);
+glm::vec4 Portal::calculatePortalScreenRect(
+    const std::shared_ptr<MeshComponent>& portalMesh,
+    const RenderView& renderView
+) {
+    if (!renderView.frustum.intersects(portalMesh->worldAABB())) {
+        return EMPTY_RECT;
+    }
+
+    const AABB& aabb = portalMesh->meshData()->aabb();
+    const glm::mat4 transform = renderView.projectionMatrix * renderView.viewMatrix * portalMesh->transform()->transformMatrix();
 
-        bool isTailPortal = i > m_maxRecursionLevel;
+    glm::vec4 rect = glm::vec4(1, 1, -1, -1);
 
-        if (isTailPortal) {
-            m_tailVirtualCamera = recursiveCameras[i - 1];
-            portalTailMesh->draw(recursiveCameras[i - 1]);
-        } else {
-            drawScene(recursiveCameras[i]);
+    for (int i = 0; i < 8; i++) {
+        const glm::vec4 corner = glm::vec4(
+            i & 1 ? aabb.max.x : aabb.min.x,
+            i & 2 ? aabb.max.y : aabb.min.y,
+            i & 4 ? aabb.max.z : aabb.min.z,
+            1.f
+        );
+
+        const glm::vec4 clip = transform * corner;
+
+        // the portal crosses the camera plane, its projection is unbounded
+        if (clip.w < 1e-5f) {
+            return FULL_SCREEN_RECT;
         }
 
-        // draw portal border
-        glStencilFunc(GL_EQUAL, i - 1, 0xFF);
+        const glm::vec2 ndc = glm::vec2(clip) / clip.w;
+
+        rect = glm::vec4(
+            std::min(rect.x, ndc.x),
+            std::min(rect.y, ndc.y),
+            std::max(rect.z, ndc.x),
+            std::max(rect.w, ndc.y)
+        );
+    }
+
+    return rect;
+}
+
+bool Portal::isEmptyRect(const glm::vec4& screenRect) {
+    return screenRect.x >= screenRect.z || screenRect.y >= screenRect.w;
+}
+
+float Portal::screenCoverage(const glm::vec4& screenRect) {
+    // NDC screen area is 4
+    return std::max(screenRect.z - screenRect.x, 0.f) * std::max(screenRect.w - screenRect.y, 0.f) / 4.f;
+}
+
+void Portal::applyScissor(const glm::vec4& screenRect, const glm::ivec4& viewport) {
+    const int x0 = static_cast<int>(std::floor((screenRect.x * 0.5f + 0.5f) * viewport.z));
+    const int y0 = static_cast<int>(std::floor((screenRect.y * 0.5f + 0.5f) * viewport.w));
+    const int x1 = static_cast<int>(std::ceil((screenRect.z * 0.5f + 0.5f) * viewport.z));
+    const int y1 = static_cast<int>(std::ceil((screenRect.w * 0.5f + 0.5f) * viewport.w));
+
+    Engine::get()->glState()->setScissor(viewport.x + x0, viewport.y + y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0));
+}
+
+void Portal::updateTailFramebuffers(TailCache& tailCache) const {
+    const auto& window = Engine::get()->window();
+
+    const int width = std::max(static_cast<int>(static_cast<float>(window->frameWidth()) * tailFramebufferScale), 1);
+    const int height = std::max(static_cast<int>(static_cast<float>(window->frameHeight()) * tailFramebufferScale), 1);
+
+    if (!tailCache.framebuffers.empty()
+        && tailCache.framebuffers[0]->width() == width
+        && tailCache.framebuffers[0]->height() == height
+    ) {
+        return;
+    }
+
+    tailCache.framebuffers.clear();
+    tailCache.isValid = false;
+
+    for (int i = 0; i < TAIL_FRAMEBUFFER_LEVELS; i++) {
+        tailCache.framebuffers.push_back(std::make_shared<PortalFramebuffer>(
+            std::max(width >> i, 1),
+            std::max(height >> i, 1)
+        ));
+    }
+}
+
+Portal::TailCacheKey Portal::createTailCacheKey(
+    const std::shared_ptr<Node>& sourcePortal,
+    const std::shared_ptr<Node>& destPortal,
+    const std::shared_ptr<Camera>& tailCamera,
+    const glm::vec4& screenRect
+) const {
+    TailCacheKey key;
 
-        portalBorderMesh->draw(recursiveCameras[i - 1]);
+    key.portalsVersion = sourcePortal->transform()->version() + destPortal->transform()->version();
 
-        // draw portal mesh to z-buffer
-        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-        glStencilFunc(GL_LEQUAL, i, 0xFF);
-        glDepthFunc(GL_ALWAYS);
+    // every next framebuffer has 4 times less pixels, so it is used when the rect covers 4 times less of the screen
+    const float coverage = screenCoverage(screenRect);
+    key.framebufferLevel = std::clamp(static_cast<int>(-std::log2(coverage) / 2.f), 0, TAIL_FRAMEBUFFER_LEVELS - 1);
 
-        portalMesh->draw(recursiveCameras[i - 1]);
+    key.screenRect = screenRect;
+    key.cameraPosition = m_camera->transform()->absolutePosition();
+    key.cameraOrientation = m_camera->transform()->absoluteOrientation();
 
-        glDepthFunc(GL_LESS);
+    const auto& spatialIndex = Engine::get()->scene()->spatialIndex();
+
+    std::vector<std::shared_ptr<MeshComponent>> dynamicMeshes;
+    spatialIndex->queryDynamicFrustum(Frustum(tailCamera->cullingMatrix()), dynamicMeshes);
+
+    for (const auto& mesh : dynamicMeshes) {
+        const size_t meshHash = std::hash<const MeshComponent*>()(mesh.get());
+        key.dynamicMeshesHash += meshHash ^ (std::hash<uint64_t>()(mesh->transform()->version()) * 31);
     }
+
+    return key;
+}
+
+bool Portal::isTailCacheOutdated(const TailCache& tailCache, const TailCacheKey& key) const {
+    if (!tailCache.isValid) {
+        return true;
+    }
+
+    const TailCacheKey& cached = tailCache.key;
+
+    // pixels outside of the rendered rect are missing in the texture
+    const bool isRectCovered = key.screenRect.x >= cached.screenRect.x && key.screenRect.y >= cached.screenRect.y
+        && key.screenRect.z <= cached.screenRect.z && key.screenRect.w <= cached.screenRect.w;
+
+    // the texture is wrong rather than slightly outdated, it is rerendered regardless of the interval
+    if (key.portalsVersion != cached.portalsVersion || key.framebufferLevel != cached.framebufferLevel || !isRectCovered) {
+        return true;
+    }
+
+    const uint64_t frameIndex = Engine::get()->window()->input()->frameIndex();
+
+    if (frameIndex - tailCache.renderFrameIndex < tailRefreshInterval) {
+        return false;
+    }
+
+    // q and -q are the same rotation
+    const float cosHalfAngle = std::abs(glm::dot(key.cameraOrientation, cached.cameraOrientation));
+    const float angle = 2.f * std::acos(std::min(cosHalfAngle, 1.f));
+
+    return key.dynamicMeshesHash != cached.dynamicMeshesHash
+        || glm::distance(key.cameraPosition, cached.cameraPosition) > tailCacheMaxDistance
+        || angle > tailCacheMaxAngle;
 }
 
 void Portal::drawTailPortalToFramebuffer(
+    TailCache& tailCache,
+    const TailCacheKey& key,
+    const std::vector<std::shared_ptr<Camera>>& recursiveCameras,
     const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene
 ) const {
+    tailCache.framebuffer = tailCache.framebuffers[key.framebufferLevel];
+    tailCache.key = key;
+    tailCache.renderFrameIndex = Engine::get()->window()->input()->frameIndex();
+    tailCache.isValid = true;
+
+    tailCache.viewMatrices.clear();
+    tailCache.projectionMatrices.clear();
+
+    for (unsigned int i = m_maxRecursionLevel; i < getTotalRecursionLevel(); i++) {
+        tailCache.viewMatrices.push_back(recursiveCameras[i]->viewMatrix());
+        tailCache.projectionMatrices.push_back(recursiveCameras[i]->projectionMatrix());
+    }
+
+    const glm::vec4& screenRect = key.screenRect;
+    const auto& framebuffer = tailCache.framebuffer;
+
     int originalFBO = 0;
     glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &originalFBO);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, m_tailPortalFramebuffer->FBO());
+    glm::ivec4 originalViewport;
+    glGetIntegerv(GL_VIEWPORT, &originalViewport.x);
+
+    const glm::ivec4 viewport = glm::ivec4(0, 0, framebuffer->width(), framebuffer->height());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer->FBO());
+    glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
 
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    static constexpr PipelineState tailState = [] {
+        PipelineState state = PipelineState::opaque();
+        state.scissorTest = true;
+        return state;
+    }();
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
+    const auto& glState = Engine::get()->glState();
 
-    glDisable(GL_STENCIL_TEST);
-    glStencilMask(0x00);
+    glState->apply(tailState);
+    applyScissor(screenRect, viewport);
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glClearColor(0, 0.5, 0, 1);
 
-    drawScene(m_virtualCameras[m_maxRecursionLevel]);
+    // tail texture is sampled as a lit color, so it is always rendered with the forward path
+    const auto deferredRenderer = DeferredRenderer::active();
+    DeferredRenderer::setActive(nullptr);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, originalFBO);
-}
+    drawScene(recursiveCameras[m_maxRecursionLevel + 1]);
 
-void Portal::createShaders() {
-    m_basicPortalShader = Engine::get()->shaderManager()->createShaderProgram(
-        "shaders/solid-color/vertex.glsl",
-        "shaders/solid-color/fragment.glsl",
-        "basic portal shader program"
-    );
+    DeferredRenderer::setActive(deferredRenderer);
 
-    m_tailPortalShader = Engine::get()->shaderManager()->createShaderProgram(
-        "shaders/tail-portal/vertex.glsl",
-        "shaders/tail-portal/fragment.glsl",
-        "tail portal shader program"
-    );
-}
-
-void Portal::createVirtualCameras() {
-    const auto virtualCamerasNode = Node::create("portalVirtualCameras", Engine::get()->scene()->rootNode());
+    glState->setEnabled(GL_SCISSOR_TEST, false);
 
-    for (int i=0; i < getTotalRecursionLevel(); i++) {
-        auto node = Node::create("virtualCameraNode"+std::to_string(i), virtualCamerasNode);
-        auto virtualCamera = Camera::Factory::create(
-            node,
-            m_camera->fov(),
-            m_camera->near(),
-            m_camera->far()
-        );
+    glBindFramebuffer(GL_FRAMEBUFFER, originalFBO);
+    glViewport(originalViewport.x, originalViewport.y, originalViewport.z, originalViewport.w);
+}
 
-        m_virtualCameras.push_back(virtualCamera);
+void Portal::checkPortalIndex(int portalIndex) const {
+    if (portalIndex != 1 && portalIndex != 2) {
+        throw std::runtime_error("Portal: incorrect portal index");
     }
 }
 
-std::vector<std::shared_ptr<Camera>> Portal::getRecursiveCameras(
-    const std::shared_ptr<Node>& sourcePortal,
-    const std::shared_ptr<Node>& destPortal
+std::vector<std::shared_ptr<Camera>> Portal::applyRenderViews(
+    const std::vector<RenderView>& renderViews,
+    const std::vector<std::shared_ptr<Camera>>& virtualCameras
 ) const {
+    if (virtualCameras.size() < getTotalRecursionLevel()) {
+        throw std::runtime_error("Portal: not enough virtual cameras");
+    }
+
     std::vector<std::shared_ptr<Camera>> result;
     result.reserve(getTotalRecursionLevel() + 1);
 
     result.push_back(m_camera);
 
-    auto pPrev = m_camera->transform()->absolutePosition();
-    auto qPrev = m_camera->transform()->absoluteOrientation();
-
-    auto [
-        qDelta, pDelta
-    ] = calculatePortalTransform(sourcePortal->transform(), destPortal->transform());
-
-    for (int i = 0; i < getTotalRecursionLevel(); i++) {
-        const auto virtualCamera = m_virtualCameras[i];
-
-        const auto pNew = pDelta + (qDelta * pPrev);
-        const auto qNew = qDelta * qPrev;
-
-        virtualCamera->transform()->setPosition(pNew);
-        virtualCamera->transform()->setOrientation(qNew);
-        virtualCamera->transform()->recalculate();
-
-        virtualCamera->recalculateViewMatrix();
-        virtualCamera->setNearPlane(destPortal->transform());
-
-        result.push_back(virtualCamera);
-        pPrev = pNew;
-        qPrev = qNew;
+    for (unsigned int i = 0; i < getTotalRecursionLevel(); i++) {
+        virtualCameras[i]->setRenderView(renderViews[i + 1]);
+        result.push_back(virtualCameras[i]);
     }
 
     return result;
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <vector>
 
-#include <glm/fwd.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 namespace SimpleGL {
 
@@ -12,19 +15,39 @@ class Node;
 class Camera;
 class Transform;
 class MeshData;
+class Material;
 class MeshComponent;
 class PortalFramebuffer;
 class ShaderProgram;
+struct PipelineState;
+struct RenderView;
 
 class Portal {
 public:
     std::shared_ptr<Node> portal1Node;
     std::shared_ptr<Node> portal2Node;
 
-    explicit Portal(const std::shared_ptr<Camera>& camera);
+    /// Recursion stops at the level which covers less than this fraction of the screen
+    float minRecursionScreenArea = 0.0005f;
 
-    static std::shared_ptr<Portal> create(
-        const std::shared_ptr<Camera>& camera
+    /// Size of the largest tail framebuffer relative to the window frame size
+    float tailFramebufferScale = 1.f;
+
+    /// Tail texture is reused while the camera moves less than these thresholds since it was rendered
+    float tailCacheMaxDistance = 0.05f;
+    float tailCacheMaxAngle = glm::radians(1.f);
+
+    /// Minimal number of frames between rerenders of a tail texture outdated by camera or dynamic mesh movement.
+    /// Values above 1 trade tail latency for a scene render on the frames in between.
+    /// Moved portals, a resize or screen rects not covered by the texture rerender it immediately
+    unsigned int tailRefreshInterval = 1;
+
+    /// Portals are created by PortalSystem, which shares the portal material, shaders and virtual cameras between them
+    Portal(
+        const std::shared_ptr<Camera>& camera,
+        const std::shared_ptr<Material>& portalMaterial,
+        const std::shared_ptr<ShaderProgram>& tailPortalShader,
+        const std::shared_ptr<ShaderProgram>& depthOnlyShader
     );
 
     void setPortalMesh(
@@ -32,8 +55,75 @@ public:
         const std::shared_ptr<MeshData>& meshData
     );
 
+    const std::shared_ptr<Node>& portalNode(int portalIndex) const;
+
+    std::shared_ptr<MeshComponent> portalMesh(int portalIndex) const;
+
+    unsigned int maxRecursionLevel() const { return m_maxRecursionLevel; }
+
+    unsigned int totalRecursionLevel() const { return getTotalRecursionLevel(); }
+
+    /// View of the main camera followed by views of all recursion levels, calculated without the scene graph.
+    /// projection is the main camera's projection without an oblique near plane
+    std::vector<RenderView> calculateRenderViews(int portalIndex, const glm::mat4& projection) const;
+
+    /// Screen rect of every recursion level in NDC as seen by the main camera, see calculateScreenRects
+    std::vector<glm::vec4> screenRects(int portalIndex, const std::vector<RenderView>& renderViews) const;
+
+    /// Recursion of one portal end prepared for drawing
+    struct View {
+        int portalIndex = 1;
+        std::vector<std::shared_ptr<Camera>> recursiveCameras;
+        std::vector<glm::vec4> screenRects;
+        /// Stencil value outside of the portal. Values of deeper levels go away from it in stencilDirection, 1 or -1
+        int stencilBase = 0;
+        int stencilDirection = 1;
+    };
+
+    /// Applies renderViews to virtualCameras, which must be at least totalRecursionLevel,
+    /// and calculates screen rects of at most levelsCount levels of the portal end set in view.
+    /// Returns false if the portal is not visible. Views drawn at the same time must not share virtual cameras
+    bool prepareView(
+        View& view,
+        const std::vector<RenderView>& renderViews,
+        unsigned int levelsCount,
+        const std::vector<std::shared_ptr<Camera>>& virtualCameras
+    ) const;
+
+    void finishView(const View& view) const;
+
+    /// State of drawStencil without the scissor test: portal surfaces are marked in the stencil buffer, stencil op and func are set per level
+    static const PipelineState& stencilPassState();
+
+    /// State of drawLevel: levels are drawn where their stencil values pass, stencil is not written
+    static const PipelineState& levelsPassState();
+
+    /// Marks recursion levels in the stencil buffer, which must be cleared to view's stencil base.
+    /// Expects stencil test and scissor test enabled
+    void drawStencil(const View& view, const glm::ivec4& viewport) const;
+
+    /// Renders the tail texture if the cached one is outdated
+    void drawTail(
+        const View& view,
+        const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene
+    );
+
+    /// Draws contents and border of a recursion level. Levels must be drawn from the deepest one.
+    /// Expects depth test, stencil test and scissor test enabled and stencil writes disabled
+    void drawLevel(
+        const View& view,
+        unsigned int level,
+        const glm::ivec4& viewport,
+        const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene
+    );
+
+    /// Draws at most levelsCount recursion levels of one portal end, with its own stencil pass.
+    /// Levels past maxRecursionLevel are tail levels, which all together cost one scene render
     void drawPortal(
         int portalIndex,
+        const std::vector<RenderView>& renderViews,
+        unsigned int levelsCount,
+        const std::vector<std::shared_ptr<Camera>>& virtualCameras,
         const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene
     );
 
@@ -44,15 +134,59 @@ public:
 
     void applyCameraNearPlane();
 
+    /// Fraction of the screen covered by an NDC rect, 0 for empty rects
+    static float screenCoverage(const glm::vec4& screenRect);
+
 private:
-    std::shared_ptr<PortalFramebuffer> m_tailPortalFramebuffer;
+    inline static const glm::vec4 FULL_SCREEN_RECT = glm::vec4(-1, -1, 1, 1);
+    inline static const glm::vec4 EMPTY_RECT = glm::vec4(1, 1, -1, -1);
+
+    /// Number of tail framebuffers, each next one is half the size of the previous one
+    static constexpr int TAIL_FRAMEBUFFER_LEVELS = 4;
+
+    /// State the tail texture depends on, the texture is rerendered when it changes
+    struct TailCacheKey {
+        uint64_t portalsVersion = 0;
+        /// Order independent hash of dynamic meshes visible to the tail camera and their transform versions
+        size_t dynamicMeshesHash = 0;
+        int framebufferLevel = 0;
+        glm::vec4 screenRect = glm::vec4(0);
+        glm::vec3 cameraPosition = glm::vec3(0);
+        glm::quat cameraOrientation = glm::quat(1, 0, 0, 0);
+    };
+
+    /// Tail texture of one portal, kept between frames
+    struct TailCache {
+        /// Framebuffers are allocated on first use and reallocated when the frame size or scale changes
+        std::vector<std::shared_ptr<PortalFramebuffer>> framebuffers;
+
+        /// The framebuffer which tail portals are textured with
+        std::shared_ptr<PortalFramebuffer> framebuffer;
+
+        /// Cameras of tail levels at the time of rendering, tail portals are reprojected with them
+        std::vector<glm::mat4> viewMatrices;
+        std::vector<glm::mat4> projectionMatrices;
 
-    ///This shader is used to render portal into stencil buffer
-    std::shared_ptr<ShaderProgram> m_basicPortalShader;
+        TailCacheKey key;
+        uint64_t renderFrameIndex = 0;
+        bool isValid = false;
+    };
+
+    std::array<TailCache, 2> m_tailCaches;
+
+    /// Camera that the tail portal being drawn is reprojected with
+    glm::mat4 m_tailCameraView = glm::mat4(1);
+    glm::mat4 m_tailCameraProjection = glm::mat4(1);
+
+    /// This material is used to render portal into stencil buffer
+    std::shared_ptr<Material> m_portalMaterial;
 
     /// This shader is used to render tail portals
     std::shared_ptr<ShaderProgram> m_tailPortalShader;
 
+    /// This shader is used to render portal into stencil and depth buffers, it reads positions only
+    std::shared_ptr<ShaderProgram> m_depthOnlyShader;
+
     /// Number of recursive portals that rerender the whole scene to draw the portal contents.
     unsigned int m_maxRecursionLevel = 2;
 
@@ -63,21 +197,55 @@ private:
         return m_maxRecursionLevel + m_maxTailRecursionLevel;
     }
 
+
     std::shared_ptr<Camera> m_camera;
-    std::shared_ptr<Camera> m_tailVirtualCamera;
 
-    std::vector<std::shared_ptr<Camera>> m_virtualCameras;
+    void checkPortalIndex(int portalIndex) const;
 
-    void createShaders();
+    /// Returns the main camera followed by virtualCameras set to renderViews
+    std::vector<std::shared_ptr<Camera>> applyRenderViews(
+        const std::vector<RenderView>& renderViews,
+        const std::vector<std::shared_ptr<Camera>>& virtualCameras
+    ) const;
+
+    /// Screen rect of every recursion level in NDC, level 0 is the whole screen.
+    /// A rect is empty (min > max) when the level is not visible, too small or over the budget
+    std::vector<glm::vec4> calculateScreenRects(
+        const std::shared_ptr<MeshComponent>& portalMesh,
+        const std::vector<RenderView>& renderViews,
+        unsigned int levelsCount
+    ) const;
+
+    static glm::vec4 calculatePortalScreenRect(
+        const std::shared_ptr<MeshComponent>& portalMesh,
+        const RenderView& renderView
+    );
 
-    void createVirtualCameras();
+    static bool isEmptyRect(const glm::vec4& screenRect);
 
-    std::vector<std::shared_ptr<Camera>> getRecursiveCameras(
+    static int stencilValue(const View& view, unsigned int level);
+
+    static void applyLevelStencilFunc(const View& view, unsigned int level);
+
+    static void applyScissor(const glm::vec4& screenRect, const glm::ivec4& viewport);
+
+    void updateTailFramebuffers(TailCache& tailCache) const;
+
+    TailCacheKey createTailCacheKey(
         const std::shared_ptr<Node>& sourcePortal,
-        const std::shared_ptr<Node>& destPortal
+        const std::shared_ptr<Node>& destPortal,
+        const std::shared_ptr<Camera>& tailCamera,
+        const glm::vec4& screenRect
     ) const;
 
+    bool isTailCacheOutdated(const TailCache& tailCache, const TailCacheKey& key) const;
+
+    /// Tail levels lie inside the screen rect of the first tail level, so only that rect is rendered,
+    /// into a smaller framebuffer if the rect is small
     void drawTailPortalToFramebuffer(
+        TailCache& tailCache,
+        const TailCacheKey& key,
+        const std::vector<std::shared_ptr<Camera>>& recursiveCameras,
         const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene
     ) const;
 };
@@ -0,0 +1,305 @@
+#include "portal_system.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <queue>
+
+#include "portal.h"
+#include "../culling/occlusion_queries.h"
+#include "../state/gl_state_cache.h"
+#include "../../managers/engine.h"
+#include "../../managers/shader_manager.h"
+#include "../../window/input.h"
+#include "../../window/window.h"
+#include "../../entities/material.h"
+#include "../../entities/components/camera.h"
+#include "../../entities/components/mesh.h"
+
+namespace SimpleGL {
+
+PortalSystem::PortalSystem(const std::shared_ptr<Camera>& camera): m_camera(camera) {
+    createShaders();
+}
+
+std::shared_ptr<Portal> PortalSystem::createPortal() {
+    auto portal = std::make_shared<Portal>(m_camera, m_portalMaterial, m_tailPortalShader, m_depthOnlyShader);
+
+    // two portal ends are drawn at the same time in the combined stencil pass
+    ensureVirtualCameras(portal->totalRecursionLevel() * 2);
+
+    m_portals.push_back(portal);
+
+    return portal;
+}
+
+void PortalSystem::drawPortals(const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene) {
+    updateFrameBudget();
+    collectVisibleViews();
+    distributeBudget();
+
+    std::vector<const PortalView*> couple;
+
+    for (const int viewIndex : m_grantOrder) {
+        const auto& view = m_views[viewIndex];
+
+        if (!combinedStencilPass) {
+            view.portal->drawPortal(view.portalIndex, view.renderViews, view.levelsCount, m_virtualCameras, drawScene);
+            continue;
+        }
+
+        // both ends are stamped without the depth test, so the first one would take the pixels they share
+        if (couple.size() == 1 && rectsOverlap(couple[0]->screenRects[1], view.screenRects[1])) {
+            drawCombined(couple, drawScene);
+            couple.clear();
+        }
+
+        couple.push_back(&view);
+
+        if (couple.size() == 2) {
+            drawCombined(couple, drawScene);
+            couple.clear();
+        }
+    }
+
+    if (!couple.empty()) {
+        drawCombined(couple, drawScene);
+    }
+}
+
+void PortalSystem::queryPortals() const {
+    if (m_occlusionQueries == nullptr) {
+        return;
+    }
+
+    std::vector<std::pair<const void*, AABB>> boxes;
+
+    for (const auto& portal : m_portals) {
+        for (int portalIndex = 1; portalIndex <= 2; portalIndex++) {
+            const auto portalMesh = portal->portalMesh(portalIndex);
+            boxes.emplace_back(portalMesh.get(), portalMesh->worldAABB());
+        }
+    }
+
+    m_occlusionQueries->query(boxes, m_camera);
+}
+
+void PortalSystem::drawCombined(
+    const std::vector<const PortalView*>& views,
+    const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene
+) {
+    std::vector<Portal::View> portalViews;
+    std::vector<std::shared_ptr<Portal>> portals;
+
+    unsigned int camerasOffset = 0;
+    unsigned int maxLevel = 0;
+
+    for (const auto* view : views) {
+        const auto& portal = view->portal;
+        const unsigned int levelsCount = portal->totalRecursionLevel();
+
+        const std::vector<std::shared_ptr<Camera>> virtualCameras(
+            m_virtualCameras.begin() + camerasOffset,
+            m_virtualCameras.begin() + camerasOffset + levelsCount
+        );
+
+        camerasOffset += levelsCount;
+
+        Portal::View portalView;
+        portalView.portalIndex = view->portalIndex;
+        portalView.stencilBase = STENCIL_MIDDLE;
+        portalView.stencilDirection = portalViews.empty() ? -1 : 1;
+
+        if (portal->prepareView(portalView, view->renderViews, view->levelsCount, virtualCameras)) {
+            portalViews.push_back(std::move(portalView));
+            portals.push_back(portal);
+            maxLevel = std::max(maxLevel, levelsCount);
+        }
+    }
+
+    if (portalViews.empty()) {
+        return;
+    }
+
+    glm::ivec4 viewport;
+    glGetIntegerv(GL_VIEWPORT, &viewport.x);
+
+    const auto& glState = Engine::get()->glState();
+
+    // prepare stencil buffer
+    glState->apply(Portal::stencilPassState());
+
+    glClearStencil(STENCIL_MIDDLE);
+    glClear(GL_STENCIL_BUFFER_BIT);
+
+    glState->setEnabled(GL_SCISSOR_TEST, true);
+
+    for (int i = 0; i < static_cast<int>(portalViews.size()); i++) {
+        portals[i]->drawStencil(portalViews[i], viewport);
+    }
+
+    glState->setEnabled(GL_SCISSOR_TEST, false);
+
+    for (int i = 0; i < static_cast<int>(portalViews.size()); i++) {
+        portals[i]->drawTail(portalViews[i], drawScene);
+    }
+
+    // draw contents of both portal ends from deepest to shallowest
+    glState->apply(Portal::levelsPassState());
+
+    for (unsigned int level = maxLevel; level >= 1; level--) {
+        for (int i = 0; i < static_cast<int>(portalViews.size()); i++) {
+            if (level <= portals[i]->totalRecursionLevel()) {
+                portals[i]->drawLevel(portalViews[i], level, viewport, drawScene);
+            }
+        }
+    }
+
+    glState->setEnabled(GL_SCISSOR_TEST, false);
+
+    for (int i = 0; i < static_cast<int>(portalViews.size()); i++) {
+        portals[i]->finishView(portalViews[i]);
+    }
+}
+
+void PortalSystem::createShaders() {
+    const auto basicPortalShader = Engine::get()->shaderManager()->createShaderProgram(
+        "shaders/solid-color/vertex.glsl",
+        "shaders/solid-color/fragment.glsl",
+        "basic portal shader program"
+    );
+
+    m_portalMaterial = std::make_shared<Material>(basicPortalShader, "portalMaterial");
+    m_portalMaterial->setParameter("color", glm::vec3(0.3, 0.3, 0.3));
+
+    m_tailPortalShader = Engine::get()->shaderManager()->createShaderProgram(
+        "shaders/tail-portal/vertex.glsl",
+        "shaders/tail-portal/fragment.glsl",
+        "tail portal shader program"
+    );
+
+    m_depthOnlyShader = Engine::get()->shaderManager()->createShaderProgram(
+        "shaders/depth-only/vertex.glsl",
+        "shaders/depth-only/fragment.glsl",
+        "depth only shader program"
+    );
+}
+
+void PortalSystem::ensureVirtualCameras(unsigned int count) {
+    if (m_virtualCameras.size() >= count) {
+        return;
+    }
+
+    // cameras are not attached to nodes, their views are set by portals
+    for (auto i = static_cast<unsigned int>(m_virtualCameras.size()); i < count; i++) {
+        m_virtualCameras.push_back(std::make_shared<Camera>(
+            m_camera->fov(),
+            m_camera->near(),
+            m_camera->far(),
+            "portalVirtualCamera" + std::to_string(i)
+        ));
+    }
+}
+
+void PortalSystem::updateFrameBudget() {
+    if (frameTimeBudget <= 0) {
+        m_budgetSceneRenders = maxSceneRenders;
+        return;
+    }
+
+    // smoothed, so a single slow frame does not make the recursion flicker
+    m_averageFrameTime = glm::mix(m_averageFrameTime, Engine::get()->window()->input()->deltaTime(), 0.1f);
+
+    if (m_averageFrameTime > frameTimeBudget && m_budgetSceneRenders > 1) {
+        m_budgetSceneRenders--;
+    }
+    else if (m_averageFrameTime < frameTimeBudget * 0.8f && m_budgetSceneRenders < maxSceneRenders) {
+        m_budgetSceneRenders++;
+    }
+
+    m_budgetSceneRenders = std::min(m_budgetSceneRenders, maxSceneRenders);
+}
+
+void PortalSystem::collectVisibleViews() {
+    m_views.clear();
+
+    // main camera's projection may have an oblique near plane, so it is not reused
+    const glm::mat4 projection = glm::perspective(
+        m_camera->fov(),
+        Engine::get()->window()->aspectRatio(),
+        m_camera->near(),
+        m_camera->far()
+    );
+
+    for (const auto& portal : m_portals) {
+        for (int portalIndex = 1; portalIndex <= 2; portalIndex++) {
+            if (m_occlusionQueries != nullptr && !m_occlusionQueries->isVisible(portal->portalMesh(portalIndex).get())) {
+                continue;
+            }
+
+            auto renderViews = portal->calculateRenderViews(portalIndex, projection);
+            auto screenRects = portal->screenRects(portalIndex, renderViews);
+
+            if (Portal::screenCoverage(screenRects[1]) > 0) {
+                m_views.push_back({ portal, portalIndex, std::move(renderViews), std::move(screenRects) });
+            }
+        }
+    }
+}
+
+void PortalSystem::distributeBudget() {
+    m_grantOrder.clear();
+
+    std::priority_queue<LevelCandidate> candidates;
+
+    for (int i = 0; i < static_cast<int>(m_views.size()); i++) {
+        candidates.push({ i, 1, Portal::screenCoverage(m_views[i].screenRects[1]) });
+    }
+
+    unsigned int sceneRenders = 0;
+    float fillCoverage = 0;
+
+    // levels are granted by coverage, a deeper level competes only after the previous one was granted
+    while (!candidates.empty() && sceneRenders < m_budgetSceneRenders) {
+        const LevelCandidate candidate = candidates.top();
+        candidates.pop();
+
+        if (fillCoverage + candidate.coverage > maxFillCoverage) {
+            continue;
+        }
+
+        auto& view = m_views[candidate.viewIndex];
+        const auto& portal = view.portal;
+
+        if (view.levelsCount == 0) {
+            m_grantOrder.push_back(candidate.viewIndex);
+        }
+
+        sceneRenders++;
+        fillCoverage += candidate.coverage;
+
+        // tail levels are drawn all together from a single scene render
+        if (candidate.level > portal->maxRecursionLevel()) {
+            view.levelsCount = portal->totalRecursionLevel();
+            continue;
+        }
+
+        view.levelsCount = candidate.level;
+
+        const unsigned int nextLevel = candidate.level + 1;
+
+        if (nextLevel <= portal->totalRecursionLevel()) {
+            const float coverage = Portal::screenCoverage(view.screenRects[nextLevel]);
+
+            if (coverage > 0) {
+                candidates.push({ candidate.viewIndex, nextLevel, coverage });
+            }
+        }
+    }
+}
+
+bool PortalSystem::rectsOverlap(const glm::vec4& a, const glm::vec4& b) {
+    return std::max(a.x, b.x) < std::min(a.z, b.z) && std::max(a.y, b.y) < std::min(a.w, b.w);
+}
+
+}
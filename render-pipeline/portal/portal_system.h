@@ -0,0 +1,118 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "render_view.h"
+
+namespace SimpleGL {
+
+class Camera;
+class Material;
+class OcclusionQueries;
+class Portal;
+class ShaderProgram;
+
+/// Manages any number of linked portal pairs.
+/// Every frame it finds which portals are visible and how much of the screen each of their recursion levels covers,
+/// then spends a global budget of scene renders and screen fill on the levels covering the most of the screen.
+/// Views of all recursion levels are calculated once per frame without the scene graph.
+/// Portals share shaders and virtual cameras, which are not attached to nodes. With combinedStencilPass, visible portal ends are drawn in couples
+/// sharing one stencil pass, paired in the order the budget grants them: one end counts its levels up from the middle stencil value
+/// and the other one down, then both are drawn in one deepest-first sweep. Ends overlapping on the screen are never coupled,
+/// as the stencil pass has no depth test to decide which one is in front. Otherwise every end is drawn with its own stencil pass.
+/// With occlusion queries set, portal ends hidden behind the scene on the previous frames are skipped.
+class PortalSystem {
+public:
+    /// Maximum number of scene renders spent on all portals per frame. Every non-tail recursion level costs one render,
+    /// all tail levels of a portal together cost one more
+    unsigned int maxSceneRenders = 8;
+
+    /// Maximum summed screen coverage of drawn recursion levels, 1 is the whole screen
+    float maxFillCoverage = 3.f;
+
+    /// Frame time in seconds above which the scene render budget is reduced. Zero disables the budget
+    float frameTimeBudget = 1.f / 60.f;
+
+    bool combinedStencilPass = true;
+
+    explicit PortalSystem(const std::shared_ptr<Camera>& camera);
+
+    std::shared_ptr<Portal> createPortal();
+
+    const std::vector<std::shared_ptr<Portal>>& portals() const { return m_portals; }
+
+    void drawPortals(const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene);
+
+    void setOcclusionQueries(const std::shared_ptr<OcclusionQueries>& occlusionQueries) { m_occlusionQueries = occlusionQueries; }
+
+    /// Queries visibility of portal ends for the next frames. Must be called after the main camera's frame is drawn
+    void queryPortals() const;
+
+private:
+    /// Stencil buffer is cleared to this value, so 127 levels fit on both sides of it
+    static constexpr int STENCIL_MIDDLE = 128;
+
+    /// One side of a portal pair
+    struct PortalView {
+        std::shared_ptr<Portal> portal;
+        int portalIndex;
+        std::vector<RenderView> renderViews;
+        std::vector<glm::vec4> screenRects;
+        /// Number of recursion levels granted by the budget this frame
+        unsigned int levelsCount = 0;
+    };
+
+    /// Next recursion level of a view competing for the budget
+    struct LevelCandidate {
+        int viewIndex;
+        unsigned int level;
+        float coverage;
+
+        bool operator<(const LevelCandidate& other) const { return coverage < other.coverage; }
+    };
+
+    std::shared_ptr<Camera> m_camera;
+    std::shared_ptr<OcclusionQueries> m_occlusionQueries;
+
+    std::shared_ptr<Material> m_portalMaterial;
+    std::shared_ptr<ShaderProgram> m_tailPortalShader;
+    std::shared_ptr<ShaderProgram> m_depthOnlyShader;
+
+    std::vector<std::shared_ptr<Portal>> m_portals;
+    std::vector<std::shared_ptr<Camera>> m_virtualCameras;
+
+    /// Visible portal views of the current frame
+    std::vector<PortalView> m_views;
+
+    /// Indices of views with granted levels, in the order their first level was granted
+    std::vector<int> m_grantOrder;
+
+    /// Scene renders allowed by the frame time budget.
+    /// Shrinks while frames are slower than the budget and grows back when they are fast again
+    unsigned int m_budgetSceneRenders = maxSceneRenders;
+    float m_averageFrameTime = 0;
+
+    void createShaders();
+
+    void ensureVirtualCameras(unsigned int count);
+
+    void updateFrameBudget();
+
+    void collectVisibleViews();
+
+    void distributeBudget();
+
+    /// Draws up to two portal ends with one stencil pass. Ends must not overlap on the screen
+    void drawCombined(
+        const std::vector<const PortalView*>& views,
+        const std::function<void(const std::shared_ptr<Camera>& camera)>& drawScene
+    );
+
+    static bool rectsOverlap(const glm::vec4& a, const glm::vec4& b);
+};
+
+}
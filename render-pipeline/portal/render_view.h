@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "../culling/frustum.h"
+
+namespace SimpleGL {
+
+/// Camera state a scene can be rendered with, without a node in the scene graph
+struct RenderView {
+    glm::vec3 position = glm::vec3(0);
+    glm::quat orientation = glm::quat(1, 0, 0, 0);
+
+    glm::mat4 viewMatrix = glm::mat4(1);
+    glm::mat4 projectionMatrix = glm::mat4(1);
+
+    /// Frustum of projectionMatrix * viewMatrix
+    Frustum frustum;
+};
+
+}
@@ -0,0 +1,151 @@
+#include "gl_state_cache.h"
+
+#include <format>
+#include <stdexcept>
+
+#include "../../managers/engine.h"
+#include "../../window/input.h"
+#include "../../window/window.h"
+
+namespace SimpleGL {
+
+void GLStateCache::apply(const PipelineState& state) {
+    setEnabled(GL_DEPTH_TEST, state.depthTest);
+    setDepthMask(state.depthWrite);
+    setDepthFunc(state.depthFunc);
+
+    setEnabled(GL_STENCIL_TEST, state.stencilTest);
+    setStencilMask(state.stencilWriteMask);
+    setStencilOp(state.stencilFail, state.stencilDepthFail, state.stencilPass);
+
+    setEnabled(GL_CULL_FACE, state.cullFace);
+    setCullFace(state.cullFaceMode);
+
+    setEnabled(GL_BLEND, state.blend);
+    setBlendFunc(state.blendSource, state.blendDestination);
+
+    setColorMask(state.colorWrite);
+
+    setEnabled(GL_SCISSOR_TEST, state.scissorTest);
+}
+
+void GLStateCache::setEnabled(GLenum capability, bool enabled) {
+    if (!change(m_capabilities[capabilityIndex(capability)], enabled)) {
+        return;
+    }
+
+    if (enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
+    }
+}
+
+void GLStateCache::setDepthFunc(GLenum func) {
+    if (change(m_depthFunc, func)) {
+        glDepthFunc(func);
+    }
+}
+
+void GLStateCache::setDepthMask(bool enabled) {
+    if (change(m_depthMask, enabled)) {
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void GLStateCache::setColorMask(bool enabled) {
+    if (change(m_colorMask, enabled)) {
+        const GLboolean mask = enabled ? GL_TRUE : GL_FALSE;
+        glColorMask(mask, mask, mask, mask);
+    }
+}
+
+void GLStateCache::setStencilFunc(GLenum func, int reference, unsigned int mask) {
+    if (change(m_stencilFunc, std::make_tuple(func, reference, mask))) {
+        glStencilFunc(func, reference, mask);
+    }
+}
+
+void GLStateCache::setStencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass) {
+    if (change(m_stencilOp, std::make_tuple(stencilFail, depthFail, depthPass))) {
+        glStencilOp(stencilFail, depthFail, depthPass);
+    }
+}
+
+void GLStateCache::setStencilMask(unsigned int mask) {
+    if (change(m_stencilMask, mask)) {
+        glStencilMask(mask);
+    }
+}
+
+void GLStateCache::setCullFace(GLenum mode) {
+    if (change(m_cullFace, mode)) {
+        glCullFace(mode);
+    }
+}
+
+void GLStateCache::setBlendFunc(GLenum source, GLenum destination) {
+    if (change(m_blendFunc, std::make_pair(source, destination))) {
+        glBlendFunc(source, destination);
+    }
+}
+
+void GLStateCache::setScissor(int x, int y, int width, int height) {
+    if (change(m_scissor, std::make_tuple(x, y, width, height))) {
+        glScissor(x, y, width, height);
+    }
+}
+
+void GLStateCache::invalidate() {
+    m_capabilities.fill(std::nullopt);
+
+    m_depthFunc.reset();
+    m_depthMask.reset();
+    m_colorMask.reset();
+
+    m_stencilFunc.reset();
+    m_stencilOp.reset();
+    m_stencilMask.reset();
+
+    m_cullFace.reset();
+    m_blendFunc.reset();
+
+    m_scissor.reset();
+}
+
+template<typename T>
+bool GLStateCache::change(std::optional<T>& cached, const T& value) {
+    const uint64_t frameIndex = Engine::get()->window()->input()->frameIndex();
+
+    if (frameIndex != m_frameIndex) {
+        m_callsLastFrame = m_calls;
+        m_redundantCallsLastFrame = m_redundantCalls;
+        m_calls = 0;
+        m_redundantCalls = 0;
+        m_frameIndex = frameIndex;
+    }
+
+    m_calls++;
+
+    if (cached == value) {
+        m_redundantCalls++;
+        return false;
+    }
+
+    cached = value;
+    return true;
+}
+
+int GLStateCache::capabilityIndex(GLenum capability) {
+    switch (capability) {
+        case GL_DEPTH_TEST: return 0;
+        case GL_STENCIL_TEST: return 1;
+        case GL_CULL_FACE: return 2;
+        case GL_BLEND: return 3;
+        case GL_SCISSOR_TEST: return 4;
+        default:
+            throw std::runtime_error(std::format("GL STATE CACHE. Capability is not cached: {}", capability));
+    }
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+#include <glad/glad.h>
+
+#include "pipeline_state.h"
+
+namespace SimpleGL {
+
+/// Mirrors fixed-function OpenGL state and drops calls which would not change it.
+/// All state changes of the engine must go through the cache, otherwise it gets out of sync. Call invalidate
+/// after state was changed by other code. Counts issued and redundant calls, results of the previous frame are reported.
+class GLStateCache {
+public:
+    /// Applies every field of state, issuing GL calls only for the differing ones
+    void apply(const PipelineState& state);
+
+    /// capability is one of GL_DEPTH_TEST, GL_STENCIL_TEST, GL_CULL_FACE, GL_BLEND and GL_SCISSOR_TEST
+    void setEnabled(GLenum capability, bool enabled);
+
+    void setDepthFunc(GLenum func);
+    void setDepthMask(bool enabled);
+    void setColorMask(bool enabled);
+
+    void setStencilFunc(GLenum func, int reference, unsigned int mask = 0xFF);
+    void setStencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass);
+    void setStencilMask(unsigned int mask);
+
+    void setCullFace(GLenum mode);
+    void setBlendFunc(GLenum source, GLenum destination);
+
+    void setScissor(int x, int y, int width, int height);
+
+    /// Forgets cached values, so the next call of every setter reaches OpenGL
+    void invalidate();
+
+    unsigned int callsLastFrame() const { return m_callsLastFrame; }
+    unsigned int redundantCallsLastFrame() const { return m_redundantCallsLastFrame; }
+
+private:
+    static constexpr int CAPABILITIES_COUNT = 5;
+
+    std::array<std::optional<bool>, CAPABILITIES_COUNT> m_capabilities;
+
+    std::optional<GLenum> m_depthFunc;
+    std::optional<bool> m_depthMask;
+    std::optional<bool> m_colorMask;
+
+    std::optional<std::tuple<GLenum, int, unsigned int>> m_stencilFunc;
+    std::optional<std::tuple<GLenum, GLenum, GLenum>> m_stencilOp;
+    std::optional<unsigned int> m_stencilMask;
+
+    std::optional<GLenum> m_cullFace;
+    std::optional<std::pair<GLenum, GLenum>> m_blendFunc;
+
+    std::optional<std::tuple<int, int, int, int>> m_scissor;
+
+    uint64_t m_frameIndex = 0;
+    unsigned int m_calls = 0;
+    unsigned int m_redundantCalls = 0;
+    unsigned int m_callsLastFrame = 0;
+    unsigned int m_redundantCallsLastFrame = 0;
+
+    /// Returns true if value differs from the cached one and stores it
+    template<typename T>
+    bool change(std::optional<T>& cached, const T& value);
+
+    static int capabilityIndex(GLenum capability);
+};
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+
+namespace SimpleGL {
+
+/// Fixed-function state of a render pass: depth, stencil, cull, blend and write masks.
+/// States are meant to be baked once as constants and applied with GLStateCache::apply, which changes only what differs.
+/// Stencil reference values and the scissor rect change per draw, so they are set on the cache directly.
+struct PipelineState {
+    bool depthTest = true;
+    bool depthWrite = true;
+    GLenum depthFunc = GL_LESS;
+
+    bool stencilTest = false;
+    unsigned int stencilWriteMask = 0x00;
+    GLenum stencilFail = GL_KEEP;
+    GLenum stencilDepthFail = GL_KEEP;
+    GLenum stencilPass = GL_KEEP;
+
+    bool cullFace = true;
+    GLenum cullFaceMode = GL_BACK;
+
+    bool blend = false;
+    GLenum blendSource = GL_ONE;
+    GLenum blendDestination = GL_ZERO;
+
+    bool colorWrite = true;
+
+    bool scissorTest = false;
+
+    /// Depth tested and written, back faces culled
+    static constexpr PipelineState opaque() { return {}; }
+
+    /// Screen quads and other passes without depth, e.g. blits
+    static constexpr PipelineState fullscreen() {
+        PipelineState state;
+        state.depthTest = false;
+        state.depthWrite = false;
+        state.cullFace = false;
+        return state;
+    }
+
+    /// Only the stencil buffer is written, incrementing or decrementing stencilPass values
+    static constexpr PipelineState stencilOnly(GLenum stencilPass) {
+        PipelineState state;
+        state.depthTest = false;
+        state.depthWrite = false;
+        state.colorWrite = false;
+        state.stencilTest = true;
+        state.stencilWriteMask = 0xFF;
+        state.stencilPass = stencilPass;
+        return state;
+    }
+};
+
+}
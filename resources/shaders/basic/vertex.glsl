@@ -1,16 +1,18 @@
 #version 410 core
 
+#include "../include/vertex-decoding.glsl"
+
 uniform mat4 transform;
 uniform mat4 view;
 uniform mat4 projection;
 
-in vec3 vPosition;
-in vec2 vTextureCoord;
+layout(location = 0) in vec3 vPosition;
+layout(location = 1) in vec2 vTextureCoord;
 
 out vec2 fTextureCoord;
 
 void main()
 {
-    gl_Position = projection * view * transform * vec4(vPosition, 1.0);
+    gl_Position = projection * view * transform * vec4(decodePosition(vPosition), 1.0);
     fTextureCoord = vTextureCoord;
 }
@@ -0,0 +1,69 @@
+#version 430 core
+
+// must match ClusteredLighting::GRID_*
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+
+// one work group per depth slice
+layout(local_size_x = CLUSTER_GRID_X, local_size_y = CLUSTER_GRID_Y) in;
+
+// must match ClusteredLighting::LIGHT_TEXELS, the first texel is position and radius
+#define LIGHT_TEXELS 4
+
+layout(std430, binding = 0) readonly buffer LightBuffer {
+    vec4 lights[];
+};
+
+// offset & count in indices per cluster
+layout(std430, binding = 1) writeonly buffer GridBuffer {
+    uvec2 grid[];
+};
+
+layout(std430, binding = 2) writeonly buffer IndexBuffer {
+    uint indices[];
+};
+
+uniform mat4 view;
+// x - near plane, y - depth slices per log-depth unit, zw - projection scale
+uniform vec4 clusterParams;
+uniform int lightsCount;
+// every cluster owns a fixed range of indices
+uniform int maxClusterLights;
+
+void main()
+{
+    uvec3 id = gl_GlobalInvocationID;
+    uint cluster = id.x + CLUSTER_GRID_X * (id.y + CLUSTER_GRID_Y * id.z);
+
+    float near = clusterParams.x;
+    float minDepth = near * exp(float(id.z) / clusterParams.y);
+    float maxDepth = near * exp(float(id.z + 1u) / clusterParams.y);
+
+    // view space bounds of the froxel, x and y scale linearly with depth
+    vec2 gridSize = vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y);
+    vec2 tileMin = (vec2(id.xy) / gridSize * 2.0 - 1.0) / clusterParams.zw;
+    vec2 tileMax = (vec2(id.xy + 1u) / gridSize * 2.0 - 1.0) / clusterParams.zw;
+
+    vec3 boxMin = vec3(min(tileMin * minDepth, tileMin * maxDepth), minDepth);
+    vec3 boxMax = vec3(max(tileMax * minDepth, tileMax * maxDepth), maxDepth);
+
+    uint offset = cluster * uint(maxClusterLights);
+    uint count = 0u;
+
+    for (int i = 0; i < lightsCount && count < uint(maxClusterLights); i++) {
+        vec4 light = lights[i * LIGHT_TEXELS];
+
+        vec3 center = (view * vec4(light.xyz, 1.0)).xyz;
+        center.z = -center.z;
+
+        vec3 distance = center - clamp(center, boxMin, boxMax);
+
+        if (dot(distance, distance) <= light.w * light.w) {
+            indices[offset + count] = uint(i);
+            count++;
+        }
+    }
+
+    grid[cluster] = uvec2(offset, count);
+}
@@ -0,0 +1,68 @@
+#version 410 core
+
+#include "../include/normal-encoding.glsl"
+
+struct DirectLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+#define MAX_DIRECT_LIGHTS_NUM 3
+
+// must match DeferredRenderer::MAX_VIEWS
+#define MAX_VIEWS_NUM 32
+
+uniform DirectLight directLights[MAX_DIRECT_LIGHTS_NUM];
+uniform int directLightsNum;
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 viewInverseViewProjections[MAX_VIEWS_NUM];
+uniform vec3 viewPositions[MAX_VIEWS_NUM];
+
+out vec4 FragColor;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, coord, 0);
+    vec4 normalData = texelFetch(gNormal, coord, 0);
+    float depth = texelFetch(gDepth, coord, 0).r;
+
+    // background and unlit surfaces (skybox, solid colors, tail portals) keep their color
+    if (depth == 1.0 || normalData.b < 0.5) {
+        FragColor = vec4(albedoSpecular.rgb, 1.0);
+        return;
+    }
+
+    int viewIndex = int(normalData.a);
+
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(gDepth, 0));
+    vec4 position = viewInverseViewProjections[viewIndex] * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    position /= position.w;
+
+    vec3 normal = decodeNormal(normalData.xy);
+    vec3 viewDir = normalize(viewPositions[viewIndex] - position.xyz);
+
+    vec3 diffuseLight = vec3(0.0);
+    vec3 specularLight = vec3(0.0);
+
+    for(int i = 0; i < directLightsNum; i++) {
+        vec3 lightDir = -directLights[i].direction;
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+
+        float diffuse = max(dot(normal, lightDir), 0.0);
+        float specular = max(dot(viewDir, halfwayDir), 0.0);
+
+        diffuseLight += directLights[i].diffuse * diffuse + directLights[i].ambient;
+        specularLight += directLights[i].specular * specular;
+    }
+
+    FragColor = vec4(diffuseLight * albedoSpecular.rgb + specularLight * albedoSpecular.a, 1.0);
+}
@@ -0,0 +1,59 @@
+#version 410 core
+
+#include "../include/normal-encoding.glsl"
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform int volumeViewIndex;
+uniform mat4 volumeInverseViewProjection;
+uniform vec3 volumeViewPosition;
+
+uniform vec3 lightPosition;
+uniform float lightDistance;
+uniform vec3 lightAmbient;
+uniform vec3 lightDiffuse;
+uniform vec3 lightSpecular;
+
+out vec4 FragColor;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+
+    vec4 normalData = texelFetch(gNormal, coord, 0);
+    float depth = texelFetch(gDepth, coord, 0).r;
+
+    // pixels of other views are lit by their own light volumes
+    if (depth == 1.0 || normalData.b < 0.5 || int(normalData.a) != volumeViewIndex) {
+        discard;
+    }
+
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(gDepth, 0));
+    vec4 position = volumeInverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    position /= position.w;
+
+    vec3 lightVec = lightPosition - position.xyz;
+    float distance = length(lightVec);
+    float attenuation = max(1 - distance / lightDistance, 0.0);
+
+    if (attenuation == 0.0) {
+        discard;
+    }
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, coord, 0);
+
+    vec3 normal = decodeNormal(normalData.xy);
+    vec3 lightDir = lightVec / distance;
+    vec3 viewDir = normalize(volumeViewPosition - position.xyz);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+
+    float diffuse = max(dot(normal, lightDir), 0.0);
+    float specular = max(dot(viewDir, halfwayDir), 0.0);
+
+    vec3 diffuseLight = attenuation * (lightDiffuse * diffuse + lightAmbient);
+    vec3 specularLight = attenuation * lightSpecular * specular;
+
+    FragColor = vec4(diffuseLight * albedoSpecular.rgb + specularLight * albedoSpecular.a, 1.0);
+}
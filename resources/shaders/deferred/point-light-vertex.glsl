@@ -0,0 +1,13 @@
+#version 410 core
+
+#include "../include/vertex-decoding.glsl"
+
+uniform mat4 transform;
+uniform mat4 volumeViewProjection;
+
+layout(location = 0) in vec3 vPosition;
+
+void main()
+{
+    gl_Position = volumeViewProjection * transform * vec4(decodePosition(vPosition), 1.0);
+}
@@ -0,0 +1,15 @@
+#version 410 core
+
+#include "../include/vertex-decoding.glsl"
+
+// reads no other attribute, so it works with position-only vertex formats
+layout(location = 0) in vec3 vPosition;
+
+uniform mat4 transform;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * view * transform * vec4(decodePosition(vPosition), 1.0);
+}
@@ -1,14 +1,16 @@
 #version 410 core
 
+#include "../include/vertex-decoding.glsl"
+
 uniform mat4 transform;
 
-in vec3 vPosition;
-in vec2 vTextureCoord;
+layout(location = 0) in vec3 vPosition;
+layout(location = 1) in vec2 vTextureCoord;
 
 out vec2 fTextureCoord;
 
 void main()
 {
-    gl_Position = transform * vec4(vPosition.xz, 0.0, 1.0);
+    gl_Position = transform * vec4(decodePosition(vPosition).xz, 0.0, 1.0);
     fTextureCoord = vTextureCoord;
 }
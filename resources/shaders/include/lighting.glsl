@@ -0,0 +1,127 @@
+// Forward lighting of lit shaders. Point lights from ClusteredLighting are added with CLUSTERED
+
+struct DirectLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+    float distance;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct LightComponents {
+    vec3 diffuse;
+    vec3 specular;
+};
+
+#define MAX_DIRECT_LIGHTS_NUM 3
+
+uniform DirectLight directLights[MAX_DIRECT_LIGHTS_NUM];
+uniform int directLightsNum;
+
+#ifdef CLUSTERED
+// must match ClusteredLighting::GRID_*
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+
+// 4 texels per light: position & distance, ambient, diffuse, specular
+uniform samplerBuffer clusterLights;
+// offset & count in clusterLightIndices per cluster
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLightIndices;
+// x - near plane, y - depth slices per log-depth unit, zw - projection scale
+uniform vec4 clusterParams;
+#endif
+
+LightComponents calcDirectLight(DirectLight light, vec3 normal, vec3 viewDir) {
+    vec3 lightDir = -light.direction;
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+
+    float diffuse = max(dot(normal, lightDir), 0.0);
+    float specular = pow(max(dot(viewDir, halfwayDir), 0.0), 1);
+
+    vec3 diffuseLight  = light.diffuse * diffuse + light.ambient;
+    vec3 specularLight = light.specular * specular;
+
+    return LightComponents(diffuseLight, specularLight);
+}
+
+LightComponents calcPointLight(PointLight light, vec3 position, vec3 normal, vec3 viewDir) {
+    vec3 lightVec = light.position - position;
+    vec3 lightDir = normalize(lightVec);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+
+    float diffuse = max(dot(normal, lightDir), 0.0);
+    float specular = pow(max(dot(viewDir, halfwayDir), 0.0), 1);
+
+    float distance = length(lightVec);
+    float attenuation = max(1 - distance / light.distance, 0.0);
+
+    vec3 diffuseLight = attenuation * (light.diffuse * diffuse + light.ambient);
+    vec3 specularLight = attenuation * light.specular * specular;
+
+    return LightComponents(diffuseLight, specularLight);
+}
+
+#ifdef CLUSTERED
+int getClusterIndex(vec3 viewSpacePosition) {
+    float depth = -viewSpacePosition.z;
+    vec2 ndc = clusterParams.zw * viewSpacePosition.xy / depth;
+
+    ivec2 tile = ivec2((ndc * 0.5 + 0.5) * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y));
+    tile = clamp(tile, ivec2(0), ivec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+
+    int slice = int(log(max(depth, clusterParams.x) / clusterParams.x) * clusterParams.y);
+    slice = clamp(slice, 0, CLUSTER_GRID_Z - 1);
+
+    return tile.x + CLUSTER_GRID_X * (tile.y + CLUSTER_GRID_Y * slice);
+}
+
+PointLight fetchPointLight(int index) {
+    int texel = index * 4;
+    vec4 positionDistance = texelFetch(clusterLights, texel);
+
+    return PointLight(
+        positionDistance.xyz,
+        positionDistance.w,
+        texelFetch(clusterLights, texel + 1).rgb,
+        texelFetch(clusterLights, texel + 2).rgb,
+        texelFetch(clusterLights, texel + 3).rgb
+    );
+}
+#endif
+
+// position is in world space, viewSpacePosition selects the cluster
+LightComponents calcLighting(vec3 position, vec3 viewSpacePosition, vec3 normal, vec3 viewDir) {
+    LightComponents result = LightComponents(vec3(0.0), vec3(0.0));
+
+    for(int i = 0; i < directLightsNum; i++) {
+        LightComponents directLightResult = calcDirectLight(directLights[i], normal, viewDir);
+
+        result.diffuse += directLightResult.diffuse;
+        result.specular += directLightResult.specular;
+    }
+
+#ifdef CLUSTERED
+    uvec2 cluster = texelFetch(clusterGrid, getClusterIndex(viewSpacePosition)).xy;
+
+    for(uint i = 0u; i < cluster.y; i++) {
+        int lightIndex = int(texelFetch(clusterLightIndices, int(cluster.x + i)).r);
+        LightComponents pointLightResult = calcPointLight(fetchPointLight(lightIndex), position, normal, viewDir);
+
+        result.diffuse += pointLightResult.diffuse;
+        result.specular += pointLightResult.specular;
+    }
+#endif
+
+    return result;
+}
@@ -0,0 +1,23 @@
+// Octahedral normal encoding of the g-buffer
+
+vec2 encodeNormal(vec3 normal) {
+    normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+
+    if (normal.z >= 0.0) {
+        return normal.xy;
+    }
+
+    vec2 signNotZero = vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+
+    return (1.0 - abs(normal.yx)) * signNotZero;
+}
+
+vec3 decodeNormal(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-normal.z, 0.0);
+
+    normal.x += normal.x >= 0.0 ? -t : t;
+    normal.y += normal.y >= 0.0 ? -t : t;
+
+    return normalize(normal);
+}
@@ -0,0 +1,19 @@
+// Attributes of quantized vertex formats, see VertexFormat::quantized.
+// Uniforms are set by MeshComponent for every draw, defaults decode float formats
+
+#include "normal-encoding.glsl"
+
+// positions are normalized to the mesh bounds
+uniform vec3 positionOffset = vec3(0.0);
+uniform vec3 positionScale = vec3(1.0);
+
+// normals are octahedral encoded into two components
+uniform bool octahedralNormals = false;
+
+vec3 decodePosition(vec3 position) {
+    return positionOffset + positionScale * position;
+}
+
+vec3 decodeVertexNormal(vec3 normal) {
+    return octahedralNormals ? decodeNormal(normal.xy) : normal;
+}
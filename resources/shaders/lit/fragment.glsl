@@ -0,0 +1,42 @@
+#version 410 core
+
+#include "../include/lighting.glsl"
+
+#ifdef TEXTURED
+uniform sampler2D diffuseTexture;
+uniform sampler2D specularTexture;
+
+in vec2 fTextureCoord;
+#else
+uniform vec3 color;
+#endif
+
+uniform vec3 viewPosition;
+
+in vec3 fPosition;
+in vec3 fNormal;
+in vec3 fViewPosition;
+
+out vec4 FragColor;
+
+void main()
+{
+#ifdef TEXTURED
+    vec3 albedo = vec3(texture(diffuseTexture, fTextureCoord));
+    vec3 specularColor = vec3(texture(specularTexture, fTextureCoord));
+#else
+    vec3 albedo = color;
+    vec3 specularColor = vec3(0.0);
+#endif
+
+#ifdef LIGHTING
+    vec3 normal = normalize(fNormal);
+    vec3 viewDir = normalize(viewPosition - fPosition);
+
+    LightComponents lighting = calcLighting(fPosition, fViewPosition, normal, viewDir);
+
+    FragColor = vec4(lighting.diffuse * albedo + lighting.specular * specularColor, 1.0f);
+#else
+    FragColor = vec4(albedo, 1.0f);
+#endif
+}
@@ -0,0 +1,39 @@
+#version 410 core
+
+#include "../include/normal-encoding.glsl"
+
+#ifdef TEXTURED
+uniform sampler2D diffuseTexture;
+uniform sampler2D specularTexture;
+
+in vec2 fTextureCoord;
+#else
+uniform vec3 color;
+#endif
+
+uniform int viewIndex;
+
+in vec3 fNormal;
+
+layout(location = 0) out vec4 gAlbedoSpecular;
+layout(location = 1) out vec4 gNormal;
+
+void main()
+{
+#ifdef TEXTURED
+    vec3 albedo = texture(diffuseTexture, fTextureCoord).rgb;
+    float specular = texture(specularTexture, fTextureCoord).r;
+#else
+    vec3 albedo = color;
+    float specular = 0.0;
+#endif
+
+#ifdef LIGHTING
+    gAlbedoSpecular = vec4(albedo, specular);
+    gNormal = vec4(encodeNormal(normalize(fNormal)), 1.0, float(viewIndex));
+#else
+    // unlit surfaces keep their color, see deferred/direct-light-fragment.glsl
+    gAlbedoSpecular = vec4(albedo, 0.0);
+    gNormal = vec4(0.0);
+#endif
+}
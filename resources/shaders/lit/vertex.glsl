@@ -0,0 +1,43 @@
+#version 410 core
+
+#include "../include/vertex-decoding.glsl"
+
+#ifdef INSTANCED
+// must match VertexFormat::INSTANCE_TRANSFORM_LOCATION, occupies 4 locations
+layout(location = 4) in mat4 vTransform;
+#else
+uniform mat4 transform;
+#endif
+
+uniform mat4 view;
+uniform mat4 projection;
+
+layout(location = 0) in vec3 vPosition;
+layout(location = 2) in vec3 vNormal;
+
+out vec3 fPosition;
+out vec3 fNormal;
+out vec3 fViewPosition;
+
+#ifdef TEXTURED
+layout(location = 1) in vec2 vTextureCoord;
+out vec2 fTextureCoord;
+#endif
+
+void main()
+{
+#ifdef INSTANCED
+    mat4 transform = vTransform;
+#endif
+
+    fPosition = vec3(transform * vec4(decodePosition(vPosition), 1.0));
+    fNormal = transpose(inverse(mat3(transform))) * decodeVertexNormal(vNormal);
+
+#ifdef TEXTURED
+    fTextureCoord = vTextureCoord;
+#endif
+
+    vec4 viewPosition = view * vec4(fPosition, 1.0);
+    fViewPosition = viewPosition.xyz;
+    gl_Position = projection * viewPosition;
+}
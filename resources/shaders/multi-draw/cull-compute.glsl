@@ -0,0 +1,70 @@
+#version 430 core
+
+// must match MultiDrawRenderer::CULL_GROUP_SIZE
+layout(local_size_x = 64) in;
+
+// must match MultiDrawRenderer::CullInstance
+struct Instance {
+    vec4 aabbMin;
+    vec4 aabbMax;
+    uint indexCount;
+    uint firstIndex;
+    int baseVertex;
+    uint padding;
+};
+
+// DrawElementsIndirectCommand
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 1) readonly buffer InstanceBuffer {
+    Instance instances[];
+};
+
+layout(std430, binding = 2) writeonly buffer CommandBuffer {
+    DrawCommand commands[];
+};
+
+layout(std430, binding = 3) buffer DrawCountBuffer {
+    uint drawCount;
+};
+
+// must match MultiDrawRenderer::CullParams, normals point inside, see Frustum
+layout(std140, binding = 1) uniform CullParams {
+    vec4 frustumPlanes[6];
+    uint instanceCount;
+};
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+
+    if (index >= instanceCount) {
+        return;
+    }
+
+    Instance instance = instances[index];
+
+    vec3 center = (instance.aabbMin.xyz + instance.aabbMax.xyz) * 0.5;
+    vec3 extents = (instance.aabbMax.xyz - instance.aabbMin.xyz) * 0.5;
+
+    for (int i = 0; i < 6; i++) {
+        vec3 normal = frustumPlanes[i].xyz;
+        float distance = dot(normal, center) + frustumPlanes[i].w;
+        float radius = dot(abs(normal), extents);
+
+        if (distance + radius < 0.0) {
+            return;
+        }
+    }
+
+    // survivors are compacted to the front, base instance keeps the instance's draw data index
+    uint slot = atomicAdd(drawCount, 1u);
+
+    commands[slot] = DrawCommand(instance.indexCount, 1u, instance.firstIndex, instance.baseVertex, index);
+}
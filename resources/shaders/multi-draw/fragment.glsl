@@ -0,0 +1,27 @@
+#version 430 core
+
+#include "../include/lighting.glsl"
+
+// must match MultiDrawRenderer::CameraBlock
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition;
+} camera;
+
+in vec3 fPosition;
+in vec3 fNormal;
+in vec3 fViewPosition;
+flat in vec3 fColor;
+
+out vec4 FragColor;
+
+void main()
+{
+    vec3 normal = normalize(fNormal);
+    vec3 viewDir = normalize(camera.viewPosition.xyz - fPosition);
+
+    vec3 diffuse = calcLighting(fPosition, fViewPosition, normal, viewDir).diffuse * fColor;
+
+    FragColor = vec4(diffuse, 1.0f);
+}
@@ -0,0 +1,18 @@
+#version 430 core
+
+#include "../include/normal-encoding.glsl"
+
+uniform int viewIndex;
+
+in vec3 fNormal;
+flat in vec3 fColor;
+
+layout(location = 0) out vec4 gAlbedoSpecular;
+layout(location = 1) out vec4 gNormal;
+
+// same output as lit/gbuffer-fragment.glsl without a texture
+void main()
+{
+    gAlbedoSpecular = vec4(fColor, 0.0);
+    gNormal = vec4(encodeNormal(normalize(fNormal)), 1.0, float(viewIndex));
+}
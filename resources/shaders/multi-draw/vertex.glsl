@@ -0,0 +1,41 @@
+#version 430 core
+
+// must match VertexFormat::*_LOCATION and GeometryBuffer::DRAW_ID_LOCATION
+layout(location = 0) in vec3 vPosition;
+layout(location = 2) in vec3 vNormal;
+layout(location = 3) in uint vDrawId;
+
+// must match MultiDrawRenderer::DrawData
+struct DrawData {
+    mat4 transform;
+    vec4 color;
+};
+
+layout(std430, binding = 0) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+};
+
+// must match MultiDrawRenderer::CameraBlock
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition;
+} camera;
+
+out vec3 fPosition;
+out vec3 fNormal;
+out vec3 fViewPosition;
+flat out vec3 fColor;
+
+void main()
+{
+    mat4 transform = draws[vDrawId].transform;
+
+    fPosition = vec3(transform * vec4(vPosition, 1.0));
+    fNormal = transpose(inverse(mat3(transform))) * vNormal;
+    fColor = draws[vDrawId].color.rgb;
+
+    vec4 viewPosition = camera.view * vec4(fPosition, 1.0);
+    fViewPosition = viewPosition.xyz;
+    gl_Position = camera.projection * viewPosition;
+}
@@ -0,0 +1,14 @@
+#version 410 core
+
+uniform samplerCube cubeMap;
+
+in vec3 fTextureCoord;
+
+layout(location = 0) out vec4 gAlbedoSpecular;
+layout(location = 1) out vec4 gNormal;
+
+void main()
+{
+    gAlbedoSpecular = vec4(texture(cubeMap, fTextureCoord).rgb, 0.0);
+    gNormal = vec4(0.0);
+}
@@ -1,9 +1,11 @@
 #version 410 core
 
+#include "../include/vertex-decoding.glsl"
+
 uniform mat4 view;
 uniform mat4 projection;
 
-in vec3 vPosition;
+layout(location = 0) in vec3 vPosition;
 
 out vec3 fTextureCoord;
 
@@ -12,6 +14,6 @@ void main()
     mat4 rotation = view;
     rotation[3] = vec4(0.0, 0.0, 0.0, 1.0);
 
-    fTextureCoord = vPosition;
-    gl_Position = (projection * rotation * vec4(vPosition, 1.0)).xyww;
+    fTextureCoord = decodePosition(vPosition);
+    gl_Position = (projection * rotation * vec4(decodePosition(vPosition), 1.0)).xyww;
 }
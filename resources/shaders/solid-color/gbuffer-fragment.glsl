@@ -0,0 +1,12 @@
+#version 410 core
+
+uniform vec3 color;
+
+layout(location = 0) out vec4 gAlbedoSpecular;
+layout(location = 1) out vec4 gNormal;
+
+void main()
+{
+    gAlbedoSpecular = vec4(color, 0.0);
+    gNormal = vec4(0.0);
+}
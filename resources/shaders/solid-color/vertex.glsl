@@ -1,6 +1,8 @@
 #version 410 core
 
-in vec3 vPosition;
+#include "../include/vertex-decoding.glsl"
+
+layout(location = 0) in vec3 vPosition;
 
 uniform mat4 transform;
 uniform mat4 view;
@@ -8,5 +10,5 @@ uniform mat4 projection;
 
 void main()
 {
-    gl_Position = projection * view * transform * vec4(vPosition, 1.0);
+    gl_Position = projection * view * transform * vec4(decodePosition(vPosition), 1.0);
 }
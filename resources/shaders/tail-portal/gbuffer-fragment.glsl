@@ -0,0 +1,21 @@
+#version 410 core
+
+uniform sampler2D albedoTexture;
+
+in vec4 fVirtualProjPos;
+
+layout(location = 0) out vec4 gAlbedoSpecular;
+layout(location = 1) out vec4 gNormal;
+
+// tail portal texture is rendered with the forward path, so it is already lit
+void main()
+{
+    vec3 ndc = fVirtualProjPos.xyz / fVirtualProjPos.w;
+    vec2 uv = ndc.xy * 0.5 + 0.5; // [-1,1] -> [0,1]
+
+    if (uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0)
+        discard;
+
+    gAlbedoSpecular = vec4(texture(albedoTexture, uv).rgb, 0.0);
+    gNormal = vec4(0.0);
+}
@@ -71,6 +71,23 @@ unsigned int BaseFrameBuffer::createColorTexture() const {
     return textureId;
 }
 
+unsigned int BaseFrameBuffer::createTexture(int internalFormat, unsigned int format, unsigned int type) const {
+    unsigned int textureId;
+    glGenTextures(1, &textureId);
+
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, internalFormat,
+        m_width, m_height,
+        0, format, type, nullptr
+    );
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return textureId;
+}
+
 int BaseFrameBuffer::getColorTextureInternalFormat() const {
     return m_hdr
         ? GL_RGBA16F
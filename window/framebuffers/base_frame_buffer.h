@@ -26,6 +26,9 @@ protected:
 
     unsigned int createColorTexture() const;
 
+    /// Creates single-sample texture with nearest filtering, used for attachments that are read with texelFetch
+    unsigned int createTexture(int internalFormat, unsigned int format, unsigned int type) const;
+
 private:
     int getColorTextureInternalFormat() const;
 
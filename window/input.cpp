@@ -24,6 +24,7 @@ void Input::updateState() {
 
     window()->getCursorPos(&m_mouseX, &m_mouseY);
     updateDeltaTime();
+    m_frameIndex += 1;
 
     if (window()->isCursorPosFixed) {
         window()->setCursorPosToCenter();
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <array>
 
@@ -31,11 +32,15 @@ public:
 
     float deltaTime() const { return m_deltaTime; }
 
+    /// Number of frames polled since the window was opened
+    uint64_t frameIndex() const { return m_frameIndex; }
+
     void setKeyState(int key, bool pressed);
 
 private:
     float m_lastFrameTime = 0;
     float m_deltaTime = 0;
+    uint64_t m_frameIndex = 0;
 
     double m_mouseX = 0;
     double m_mouseY = 0;
@@ -89,9 +89,17 @@ void Window::pollEvents() const {
 }
 
 GLFWwindow* Window::createGLFWWindow(int screenWidth, int screenHeight) {
-    GLFWwindow* glfwWindow = glfwCreateWindow(
-        screenWidth, screenHeight, "No title", nullptr, nullptr
-    );
+    GLFWwindow* glfwWindow = nullptr;
+
+    // 4.3 enables optional paths like multi-draw indirect, macOS supports 4.1 at most
+    for (const int minorVersion : { 3, 1 }) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minorVersion);
+        glfwWindow = glfwCreateWindow(screenWidth, screenHeight, "No title", nullptr, nullptr);
+
+        if (glfwWindow != nullptr) {
+            break;
+        }
+    }
 
     if (glfwWindow == nullptr) {
         glfwTerminate();
@@ -7,6 +7,8 @@
 #include "../entities/components/mesh.h"
 #include "../entities/shader_program.h"
 #include "../entities/components/transform.h"
+#include "../render-pipeline/deferred/deferred_renderer.h"
+#include "../render-pipeline/state/gl_state_cache.h"
 
 #include "framebuffers/msaa_frame_buffer.h"
 #include "framebuffers/screen_frame_buffer.h"
@@ -21,8 +23,14 @@ WindowPanel::WindowPanel(WindowPanelLocation location, WindowPanelSettings setti
     initQuadNode();
 }
 
+WindowPanel::~WindowPanel() = default;
+
 void WindowPanel::initFrameBuffers() {
-    m_msaaFrameBuffer = m_settings.msaaSamples > 1
+    m_deferredRenderer = m_settings.renderPath == Deferred
+        ? std::make_unique<DeferredRenderer>(frameWidth(), frameHeight())
+        : nullptr;
+
+    m_msaaFrameBuffer = m_settings.msaaSamples > 1 && m_deferredRenderer == nullptr
         ? std::make_unique<MsaaFrameBuffer>(frameWidth(), frameHeight(), m_settings.hdrEnabled, m_settings.msaaSamples)
         : nullptr;
 
@@ -65,7 +73,14 @@ void WindowPanel::renderToFrame(const std::function<void()> &drawCallback) const
     const int frameWidth = this->frameWidth();
     const int frameHeight = this->frameHeight();
 
-    if (m_msaaFrameBuffer != nullptr) {
+    if (m_deferredRenderer != nullptr) {
+        m_deferredRenderer->beginGeometryPass();
+
+        drawCallback();
+
+        m_deferredRenderer->endGeometryPass();
+        m_deferredRenderer->lightingPass(screenFBO);
+    } else if (m_msaaFrameBuffer != nullptr) {
         const unsigned int msaaFBO = m_msaaFrameBuffer->FBO();
 
         glBindFramebuffer(GL_FRAMEBUFFER, msaaFBO);
@@ -89,16 +104,11 @@ void WindowPanel::renderToFrame(const std::function<void()> &drawCallback) const
 
 void WindowPanel::renderToScreen() const {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glClearColor(1.0f, 0.0f, 1.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    glDisable(GL_DEPTH_TEST);
-    glDepthMask(GL_FALSE);
 
-    glDisable(GL_STENCIL_TEST);
-    glStencilMask(0x00);
+    Engine::get()->glState()->apply(PipelineState::fullscreen());
 
-    glDisable(GL_CULL_FACE);
+    glClearColor(1.0f, 0.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
 
     m_quadMesh->draw();
 }
@@ -8,6 +8,7 @@ namespace SimpleGL {
 class ShaderProgram;
 class ScreenFrameBuffer;
 class MsaaFrameBuffer;
+class DeferredRenderer;
 class Node;
 class MeshComponent;
 
@@ -19,16 +20,24 @@ struct WindowPanelLocation {
     float height = 1;
 };
 
+enum RenderPath {
+    Forward,
+    Deferred
+};
+
 struct WindowPanelSettings {
     int frameWidth = -1;
     int frameHeight = -1;
     int msaaSamples = 1;
     bool hdrEnabled = false;
+    /// Deferred path ignores msaaSamples
+    RenderPath renderPath = Forward;
 };
 
 class WindowPanel {
 public:
     WindowPanel(WindowPanelLocation location, WindowPanelSettings settings);
+    ~WindowPanel();
 
     int frameWidth() const;
     int frameHeight() const;
@@ -42,6 +51,7 @@ private:
 
     std::unique_ptr<ScreenFrameBuffer> m_screenFrameBuffer;
     std::unique_ptr<MsaaFrameBuffer> m_msaaFrameBuffer;
+    std::unique_ptr<DeferredRenderer> m_deferredRenderer;
 
     std::shared_ptr<Node> m_quadNode;
     std::shared_ptr<MeshComponent> m_quadMesh;